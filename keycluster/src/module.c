@@ -27,6 +27,7 @@
 #define BLACKBERRY_TRACKBALL_DOWN_PIN 12
 
 pointer_delta_t PointerDelta;
+volatile uint8_t PointerDeltaSequence; // Incremented after every update of PointerDelta
 
 key_vector_t KeyVector = {
     .itemNum = KEYBOARD_VECTOR_ITEMS_NUM,
@@ -101,6 +102,7 @@ void BlackberryTrackball_Update(void)
         PointerDelta.y = 0;
         firstRun = false;
     }
+    PointerDeltaSequence++;
 }
 
 void Module_Init(void)
@@ -35,6 +35,7 @@
 
     extern key_vector_t KeyVector;
     extern pointer_delta_t PointerDelta;
+    extern volatile uint8_t PointerDeltaSequence;
 
 // Functions:
 
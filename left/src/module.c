@@ -1,6 +1,7 @@
 #include "module.h"
 
 pointer_delta_t PointerDelta;
+volatile uint8_t PointerDeltaSequence; // Incremented after every update of PointerDelta
 
 key_matrix_t KeyMatrix = {
     .colNum = KEYBOARD_MATRIX_COLS_NUM,
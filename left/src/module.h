@@ -40,6 +40,7 @@
 
     extern key_matrix_t KeyMatrix;
     extern pointer_delta_t PointerDelta;
+    extern volatile uint8_t PointerDeltaSequence;
 
 // Functions:
 
@@ -0,0 +1,9 @@
+#include "boot_phases.h"
+#include "timer.h"
+
+uint32_t BootPhaseTimestamps[BootPhase_Count];
+
+void BootPhases_Mark(boot_phase_t bootPhase)
+{
+    BootPhaseTimestamps[bootPhase] = Timer_GetCurrentTimeMicros();
+}
@@ -0,0 +1,27 @@
+#ifndef __BOOT_PHASES_H__
+#define __BOOT_PHASES_H__
+
+// Includes:
+
+    #include <stdint.h>
+
+// Typedefs:
+
+    typedef enum {
+        BootPhase_HardwareConfigRead,
+        BootPhase_UserConfigRead,
+        BootPhase_ConfigApplied,
+        BootPhase_MacrosInitialized,
+        BootPhase_Count,
+    } boot_phase_t;
+
+// Variables:
+
+    // Microseconds since reset at which the phases have been completed
+    extern uint32_t BootPhaseTimestamps[BootPhase_Count];
+
+// Functions:
+
+    void BootPhases_Mark(boot_phase_t bootPhase);
+
+#endif
@@ -319,6 +319,20 @@ status_t usb_hid_packet_read(const peripheral_descriptor_t *self,
     return kStatus_Success;
 }
 
+// Arms the interrupt out pipe for the next report before the next usb_hid_packet_read(), so that
+// the host can send it while the current packet is being forwarded to the target. The caller must
+// be done with the packet returned by the previous read because the same report buffer is used.
+void usb_hid_packet_prefetch(const peripheral_descriptor_t *self)
+{
+    if (is_usb_active() && BuspalCompositeUsbDevice.hid_generic.hid_packet.isReceiveDataRequestRequired)
+    {
+        USB_DeviceHidRecv(BuspalCompositeUsbDevice.hid_generic.hid_handle, USB_HID_GENERIC_ENDPOINT_OUT,
+                          (uint8_t *)&BuspalCompositeUsbDevice.hid_generic.hid_packet.report.header,
+                          sizeof(BuspalCompositeUsbDevice.hid_generic.hid_packet.report));
+        BuspalCompositeUsbDevice.hid_generic.hid_packet.isReceiveDataRequestRequired = false;
+    }
+}
+
 status_t usb_hid_packet_write(const peripheral_descriptor_t *self,
                               const uint8_t *packet,
                               uint32_t byteCount,
@@ -425,6 +439,10 @@ void configure_i2c_address(uint8_t address)
 void configure_i2c_speed(uint32_t speedkhz)
 {
     s_i2cUserConfig.baudRate_kbps = speedkhz;
+    uint32_t baudRate = MIN(speedkhz * 1000, I2C_MAIN_BUS_BUSPAL_MAX_BAUD_RATE);
+    if (baudRate) {
+        I2C_MasterSetBaudRate(I2C_MAIN_BUS_BASEADDR, baudRate, CLOCK_GetFreq(I2C_MAIN_BUS_CLK_SRC));
+    }
 }
 
 status_t send_i2c_data(uint8_t *src, uint32_t writeLength)
@@ -7,6 +7,8 @@
 #include "bootloader/wormhole.h"
 
 #define FIXED_BUSPAL_BOOTLOADER  1 // Used to mark the fixed BusPal bootloader. Macro usage can be removed in the future.
+#define START_BYTE_POLL_INTERVAL_US 100
+#define START_BYTE_POLL_RETRIES 640 // Keeps the 64 ms timeout of the original 128 * 500 us polling.
 
 command_processor_data_t g_commandData;
 buspal_state_t g_buspalState = kBuspal_Idle;
@@ -34,7 +36,7 @@ static status_t peripheral_write(uint8_t *src, uint32_t writeLength);
 static int WaitForStartByte(uint8_t *buf, size_t *nofRead)
 {
     uint8_t tmp;
-    int cntr = 128; /* max retries */
+    int cntr = START_BYTE_POLL_RETRIES; /* max retries */
 
     microseconds_delay(1000); /* initial delay of 1 ms, see errata of KL03Z ROM Bootloader */
     while(cntr>0)
@@ -46,7 +48,7 @@ static int WaitForStartByte(uint8_t *buf, size_t *nofRead)
           *nofRead = 1; /* return number of bytes read */
           return 1; /* ok */
       }
-      microseconds_delay(500); /* just wait for some time until the next retry */
+      microseconds_delay(START_BYTE_POLL_INTERVAL_US); /* just wait for some time until the next retry */
       cntr--; /* keep track of retries */
     }
     *nofRead = 0; /* nothing read */
@@ -362,6 +364,14 @@ static status_t handle_data_write(bool *hasMoreData)
     }
 
     framingPacket.dataPacket.crc16 = calculate_framing_crc16(&framingPacket.dataPacket, (uint8_t *)framingPacket.data);
+
+    // Let the host send the next packet while this one is written to the target.
+    bool isNextPacketPrefetched = remaining > packetLength;
+    if (isNextPacketPrefetched)
+    {
+        usb_hid_packet_prefetch(&g_peripherals[0]);
+    }
+
     // send framing packet to target peripheral
     if (peripheral_write((uint8_t *)&framingPacket, sizeof(framing_data_packet_t) + framingPacket.dataPacket.length) !=
         kStatus_Success)
@@ -421,6 +431,11 @@ static status_t handle_data_write(bool *hasMoreData)
     else if (status != kStatus_Success)
     {
         debug_printf("writePacket aborted due to status 0x%x\r\n", status);
+        if (isNextPacketPrefetched)
+        {
+            // The response reuses the report buffer, so wait for the prefetched packet to land and drop it.
+            usb_hid_packet_read(&g_peripherals[0], &packet, &packetLength, kPacketType_Data);
+        }
         finalize_data_phase(status);
         *hasMoreData = false;
     }
@@ -0,0 +1,204 @@
+#include <string.h>
+#include "combos.h"
+#include "postponer.h"
+#include "macros.h"
+#include "timer.h"
+
+uint8_t ComboCount = 0;
+uint16_t ComboTimeout = COMBO_DEFAULT_TIMEOUT;
+
+static combo_t combos[COMBO_MAX_COUNT];
+
+// For every key, the set of combos which the key is a member of.
+static combo_mask_t comboKeyMasks[SLOT_COUNT][MAX_KEY_COUNT_PER_MODULE];
+
+// Matching state of the keypress at the head of the postponer queue. Every
+// postponed event is fed into the automaton once; the automaton is restarted
+// whenever the head of the queue changes.
+static struct {
+    key_state_t *startKey;
+    uint32_t startTime;
+    key_state_t *pressedKeys[COMBO_MAX_KEY_COUNT];
+    combo_mask_t candidates;
+    uint8_t pressedCount;
+    uint8_t fedEventCount;
+    bool windowClosed : 1;
+    bool memberReleased : 1;
+    bool rejected : 1;
+} automaton;
+
+static combo_mask_t comboKeyMask(key_state_t *keyState)
+{
+    key_state_t *firstKeyState = &KeyStates[0][0];
+    if (keyState < firstKeyState || keyState >= firstKeyState + SLOT_COUNT*MAX_KEY_COUNT_PER_MODULE) {
+        return 0;
+    }
+    return (&comboKeyMasks[0][0])[keyState - firstKeyState];
+}
+
+static void compileCombos(void)
+{
+    memset(comboKeyMasks, 0, sizeof comboKeyMasks);
+    ComboCount = 0;
+    for (uint8_t comboIdx = 0; comboIdx < COMBO_MAX_COUNT; comboIdx++) {
+        combo_t *combo = &combos[comboIdx];
+        for (uint8_t i = 0; i < combo->keyCount; i++) {
+            (&comboKeyMasks[0][0])[combo->keys[i] - &KeyStates[0][0]] |= (combo_mask_t)1 << comboIdx;
+        }
+        if (combo->keyCount > 0) {
+            ComboCount = comboIdx + 1;
+        }
+    }
+    automaton.startKey = NULL;
+}
+
+bool Combos_IsComboKey(key_state_t *keyState)
+{
+    return comboKeyMask(keyState) != 0;
+}
+
+void Combos_SetCombo(uint8_t comboIdx, key_state_t **keys, uint8_t keyCount, key_action_t action)
+{
+    combo_t *combo = &combos[comboIdx];
+
+    combo->keyCount = action.type == KeyActionType_None ? 0 : keyCount;
+    memcpy(combo->keys, keys, keyCount * sizeof *keys);
+    combo->action.action = action;
+    combo->action.modifierLayerMask = 0;
+
+    compileCombos();
+}
+
+// Makes the automaton start over, e.g. after an event got inserted into the postponer queue.
+void Combos_ResetAutomaton(void)
+{
+    automaton.startKey = NULL;
+}
+
+static void restartAutomaton(postponer_buffer_record_type_t *head)
+{
+    memset(&automaton, 0, sizeof automaton);
+    automaton.startKey = head->key;
+    automaton.startTime = head->time;
+    automaton.candidates = head->active ? comboKeyMask(head->key) : 0;
+    automaton.pressedKeys[0] = head->key;
+    automaton.pressedCount = 1;
+    automaton.fedEventCount = 1;
+}
+
+static bool wasPressedInAttempt(key_state_t *keyState)
+{
+    for (uint8_t i = 0; i < automaton.pressedCount && i < COMBO_MAX_KEY_COUNT; i++) {
+        if (automaton.pressedKeys[i] == keyState) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void feedPendingEvents(void)
+{
+    postponer_buffer_record_type_t *event;
+
+    while (
+            automaton.candidates != 0 && !automaton.windowClosed && !automaton.memberReleased &&
+            (event = PostponerExtended_PendingEvent(automaton.fedEventCount)) != NULL
+    ) {
+        if (event->time - automaton.startTime > ComboTimeout) {
+            automaton.windowClosed = true;
+            break;
+        }
+        if (event->active) {
+            automaton.candidates &= comboKeyMask(event->key);
+            if (automaton.pressedCount < COMBO_MAX_KEY_COUNT) {
+                automaton.pressedKeys[automaton.pressedCount] = event->key;
+            }
+            automaton.pressedCount++;
+        } else if (wasPressedInAttempt(event->key)) {
+            automaton.memberReleased = true;
+            break;
+        }
+        automaton.fedEventCount++;
+    }
+}
+
+static void activateCombo(uint8_t comboIdx)
+{
+    combo_t *combo = &combos[comboIdx];
+
+    PostponerExtended_ConsumePendingKeypresses(combo->keyCount, true);
+    combo->fakeKeyState.current = true;
+    WAKE_MACROS_ON_KEYSTATE_CHANGE(&combo->fakeKeyState);
+    automaton.startKey = NULL;
+}
+
+// Called by postponer before it replays the next event. Keeps the postponer
+// postponing for as long as the keypress at the head of the queue may still
+// turn out to be a part of a combo.
+void Combos_RunPostponedEvents(void)
+{
+    postponer_buffer_record_type_t *head = PostponerExtended_PendingEvent(0);
+
+    if (head == NULL) {
+        automaton.startKey = NULL;
+        return;
+    }
+    if (head->key != automaton.startKey || head->time != automaton.startTime) {
+        restartAutomaton(head);
+    }
+    if (automaton.rejected) {
+        return;
+    }
+
+    feedPendingEvents();
+
+    bool windowOpen = !automaton.windowClosed && !automaton.memberReleased && CurrentTime - automaton.startTime <= ComboTimeout;
+    combo_mask_t complete = 0;
+    combo_mask_t extensible = 0;
+    for (uint8_t comboIdx = 0; comboIdx < ComboCount; comboIdx++) {
+        if (automaton.candidates & ((combo_mask_t)1 << comboIdx)) {
+            if (combos[comboIdx].keyCount == automaton.pressedCount) {
+                complete |= (combo_mask_t)1 << comboIdx;
+            } else {
+                extensible |= (combo_mask_t)1 << comboIdx;
+            }
+        }
+    }
+
+    if (complete != 0 && (extensible == 0 || !windowOpen)) {
+        activateCombo(__builtin_ctzl(complete));
+    } else if (extensible != 0 && windowOpen) {
+        PostponerCore_PostponeNCycles(0);
+    } else {
+        automaton.rejected = true;
+    }
+}
+
+static bool allMembersHeld(combo_t *combo)
+{
+    for (uint8_t i = 0; i < combo->keyCount; i++) {
+        if (!combo->keys[i]->debouncedSwitchState) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A combo stays active for as long as all of its member keys are held.
+void Combos_ApplyActions(void)
+{
+    for (uint8_t comboIdx = 0; comboIdx < ComboCount; comboIdx++) {
+        combo_t *combo = &combos[comboIdx];
+        key_state_t *keyState = &combo->fakeKeyState;
+
+        if (keyState->current && !allMembersHeld(combo)) {
+            keyState->current = false;
+            WAKE_MACROS_ON_KEYSTATE_CHANGE(keyState);
+        }
+
+        if (KeyState_NonZero(keyState)) {
+            ApplyKeyAction(keyState, &combo->action, &combo->action.action);
+            keyState->previous = keyState->current;
+        }
+    }
+}
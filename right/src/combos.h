@@ -0,0 +1,44 @@
+#ifndef __COMBOS_H__
+#define __COMBOS_H__
+
+// Includes:
+
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include "key_action.h"
+    #include "key_states.h"
+    #include "usb_report_updater.h"
+
+// Macros:
+
+    #define COMBO_MAX_COUNT 32
+    #define COMBO_MAX_KEY_COUNT 4
+    #define COMBO_DEFAULT_TIMEOUT 50
+
+// Typedefs:
+
+    // Bit n is set if combo n can still be matched.
+    typedef uint32_t combo_mask_t;
+
+    typedef struct {
+        key_state_t *keys[COMBO_MAX_KEY_COUNT];
+        uint8_t keyCount;
+        key_action_cached_t action;
+        // Stands in for the member keys while the combo is held.
+        key_state_t fakeKeyState;
+    } combo_t;
+
+// Variables:
+
+    extern uint8_t ComboCount;
+    extern uint16_t ComboTimeout;
+
+// Functions:
+
+    bool Combos_IsComboKey(key_state_t *keyState);
+    void Combos_SetCombo(uint8_t comboIdx, key_state_t **keys, uint8_t keyCount, key_action_t action);
+    void Combos_RunPostponedEvents(void);
+    void Combos_ResetAutomaton(void);
+    void Combos_ApplyActions(void);
+
+#endif
@@ -12,6 +12,14 @@
         uint16_t offset;
     } config_buffer_t;
 
+    // A contiguous part of the user configuration which can be re-applied on its own.
+    typedef struct {
+        uint16_t offset;
+        uint16_t length;
+        uint16_t hash;
+        uint16_t context;
+    } config_section_t;
+
 // Functions:
 
     uint8_t ReadUInt8(config_buffer_t *buffer);
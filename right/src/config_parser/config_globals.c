@@ -15,6 +15,31 @@ hardware_config_t *HardwareConfig = (hardware_config_t*)hardwareConfig;
 
 bool ParserRunDry;
 
+// Pages of every config buffer which are known to hold what the EEPROM stores at the matching address, so
+// that their hashes are the ones which eeprom.c keeps for the EEPROM pages. They belong to the memory of
+// the buffers rather than to the buffer ids, which get swapped on applying a configuration.
+typedef struct {
+    const uint8_t *buffer;
+    uint16_t eepromPageIdx;
+    uint16_t pageCount;
+    uint8_t *pagesInSync;
+} config_buffer_pages_t;
+
+#define USER_CONFIG_PAGE_COUNT ((USER_CONFIG_SIZE + EEPROM_PAGE_SIZE - 1) / EEPROM_PAGE_SIZE)
+#define HARDWARE_CONFIG_PAGE_COUNT ((HARDWARE_CONFIG_SIZE + EEPROM_PAGE_SIZE - 1) / EEPROM_PAGE_SIZE)
+
+static uint8_t hardwareConfigPagesInSync[(HARDWARE_CONFIG_PAGE_COUNT + 7) / 8];
+static uint8_t stagingUserConfigPagesInSync[(USER_CONFIG_PAGE_COUNT + 7) / 8];
+static uint8_t validatedUserConfigPagesInSync[(USER_CONFIG_PAGE_COUNT + 7) / 8];
+
+static config_buffer_pages_t configBufferPages[] = {
+    { hardwareConfig, 0, HARDWARE_CONFIG_PAGE_COUNT, hardwareConfigPagesInSync },
+    { stagingUserConfig, HARDWARE_CONFIG_PAGE_COUNT, USER_CONFIG_PAGE_COUNT, stagingUserConfigPagesInSync },
+    { validatedUserConfig, HARDWARE_CONFIG_PAGE_COUNT, USER_CONFIG_PAGE_COUNT, validatedUserConfigPagesInSync },
+};
+
+#define CONFIG_BUFFER_PAGES_COUNT (sizeof(configBufferPages) / sizeof(configBufferPages[0]))
+
 bool IsConfigBufferIdValid(config_buffer_id_t configBufferId)
 {
     return ConfigBufferId_HardwareConfig <= configBufferId && configBufferId <= ConfigBufferId_ValidatedUserConfig;
@@ -46,3 +71,104 @@ uint16_t ConfigBufferIdToBufferSize(config_buffer_id_t configBufferId)
             return 0;
     }
 }
+
+static config_buffer_pages_t* findBufferPages(const uint8_t *buffer)
+{
+    for (uint8_t i = 0; i < CONFIG_BUFFER_PAGES_COUNT; i++) {
+        if (configBufferPages[i].buffer == buffer) {
+            return &configBufferPages[i];
+        }
+    }
+    return NULL;
+}
+
+static void setPagesInSync(config_buffer_pages_t *pages, uint16_t offset, uint16_t length, bool isInSync)
+{
+    for (uint16_t page = offset / EEPROM_PAGE_SIZE; page <= (offset + length - 1) / EEPROM_PAGE_SIZE && page < pages->pageCount; page++) {
+        if (isInSync) {
+            pages->pagesInSync[page / 8] |= 1 << (page % 8);
+        } else {
+            pages->pagesInSync[page / 8] &= ~(1 << (page % 8));
+        }
+    }
+}
+
+static bool isPageInSync(config_buffer_pages_t *pages, uint16_t page)
+{
+    return pages->pagesInSync[page / 8] & (1 << (page % 8));
+}
+
+// FNV-1a
+static uint64_t updateHash(uint64_t hash, const uint8_t *data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t ConfigBuffer_HashPage(const uint8_t *page)
+{
+    return updateHash(CONFIG_HASH_SEED, page, EEPROM_PAGE_SIZE);
+}
+
+void ConfigBuffer_MarkChanged(const uint8_t *buffer, uint16_t offset, uint16_t length)
+{
+    config_buffer_pages_t *pages = findBufferPages(buffer);
+    if (pages == NULL || length == 0) {
+        return;
+    }
+    setPagesInSync(pages, offset, length, false);
+}
+
+static void syncWithEeprom(const uint8_t *buffer, uint16_t offset, uint16_t length, bool isBufferInSync)
+{
+    config_buffer_pages_t *pages = findBufferPages(buffer);
+    if (pages == NULL || length == 0) {
+        return;
+    }
+    for (uint8_t i = 0; i < CONFIG_BUFFER_PAGES_COUNT; i++) {
+        if (configBufferPages[i].eepromPageIdx == pages->eepromPageIdx) {
+            setPagesInSync(&configBufferPages[i], offset, length, isBufferInSync && &configBufferPages[i] == pages);
+        }
+    }
+}
+
+// Called by eeprom.c once the given part of the buffer is the same as on the EEPROM. Other buffers which
+// map to the same EEPROM pages no longer are.
+void ConfigBuffer_MarkInSyncWithEeprom(const uint8_t *buffer, uint16_t offset, uint16_t length)
+{
+    syncWithEeprom(buffer, offset, length, true);
+}
+
+// Called by eeprom.c when writing the given part of the buffer has failed, which leaves the content of the
+// EEPROM pages unknown.
+void ConfigBuffer_MarkEepromChanged(const uint8_t *buffer, uint16_t offset, uint16_t length)
+{
+    syncWithEeprom(buffer, offset, length, false);
+}
+
+bool ConfigBuffer_IsPageInSyncWithEeprom(const uint8_t *buffer, uint16_t offset)
+{
+    config_buffer_pages_t *pages = findBufferPages(buffer);
+    return pages != NULL && isPageInSync(pages, offset / EEPROM_PAGE_SIZE);
+}
+
+// Hashes the first length bytes of the buffer from the hashes of its whole pages and the bytes of the last
+// partial page. The hashes of pages which are in sync with the EEPROM are taken from eeprom.c.
+uint64_t ConfigBuffer_Hash(const uint8_t *buffer, uint16_t length)
+{
+    config_buffer_pages_t *pages = findBufferPages(buffer);
+    uint64_t hash = updateHash(CONFIG_HASH_SEED, (const uint8_t*)&length, sizeof length);
+    uint16_t pageCount = length / EEPROM_PAGE_SIZE;
+
+    for (uint16_t page = 0; page < pageCount; page++) {
+        uint64_t pageHash;
+        if (pages == NULL || !isPageInSync(pages, page) || !EEPROM_GetPageHash(pages->eepromPageIdx + page, &pageHash)) {
+            pageHash = ConfigBuffer_HashPage(buffer + page * EEPROM_PAGE_SIZE);
+        }
+        hash = updateHash(hash, (const uint8_t*)&pageHash, sizeof pageHash);
+    }
+    return updateHash(hash, buffer + pageCount * EEPROM_PAGE_SIZE, length % EEPROM_PAGE_SIZE);
+}
@@ -10,6 +10,8 @@
 // Macros:
 
     #define HARDWARE_CONFIG_SIGNATURE_LENGTH 3
+    // FNV-1a offset basis
+    #define CONFIG_HASH_SEED 14695981039346656037ULL
 
 // Typedefs:
 
@@ -34,6 +36,7 @@
 
 // Variables:
 
+    // When set, the parser only validates the configuration and records it into the staging structures.
     extern bool ParserRunDry;
     extern uint16_t ValidatedUserConfigLength;
     extern config_buffer_t HardwareConfigBuffer;
@@ -46,5 +49,11 @@
     bool IsConfigBufferIdValid(config_buffer_id_t configBufferId);
     config_buffer_t* ConfigBufferIdToConfigBuffer(config_buffer_id_t configBufferId);
     uint16_t ConfigBufferIdToBufferSize(config_buffer_id_t configBufferId);
+    void ConfigBuffer_MarkChanged(const uint8_t *buffer, uint16_t offset, uint16_t length);
+    void ConfigBuffer_MarkInSyncWithEeprom(const uint8_t *buffer, uint16_t offset, uint16_t length);
+    void ConfigBuffer_MarkEepromChanged(const uint8_t *buffer, uint16_t offset, uint16_t length);
+    bool ConfigBuffer_IsPageInSyncWithEeprom(const uint8_t *buffer, uint16_t offset);
+    uint64_t ConfigBuffer_HashPage(const uint8_t *page);
+    uint64_t ConfigBuffer_Hash(const uint8_t *buffer, uint16_t length);
 
 #endif
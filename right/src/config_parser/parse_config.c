@@ -9,11 +9,71 @@
 #include "slave_drivers/is31fl3xxx_driver.h"
 #include "config.h"
 #include "mouse_controller.h"
+#include "crc16.h"
 
     uint16_t DataModelMajorVersion = 0;
     uint16_t DataModelMinorVersion = 0;
     uint16_t DataModelPatchVersion = 0;
 
+    staging_config_t StagingConfig;
+
+// Sections of the currently applied configuration.
+static config_section_t moduleConfigurationsSection;
+static config_section_t macrosSection;
+
+// The hash covers the position of the section and the context it has been validated in, too, so that
+// an equal hash means that the section parses to the same result.
+static uint16_t hashConfigSection(config_buffer_t *buffer, uint16_t offset, uint16_t length, uint16_t context)
+{
+    uint16_t hash;
+    crc16_data_t crc16Data;
+    uint16_t seed[] = { offset, length, DataModelMajorVersion, context };
+
+    crc16_init(&crc16Data);
+    crc16_update(&crc16Data, (const uint8_t*)seed, sizeof seed);
+    crc16_update(&crc16Data, buffer->buffer + offset, length);
+    crc16_finalize(&crc16Data, &hash);
+    return hash;
+}
+
+bool ConfigSectionsEqual(const config_section_t *a, const config_section_t *b)
+{
+    return a->length != 0 && a->offset == b->offset && a->length == b->length && a->hash == b->hash;
+}
+
+// Moves past the section starting at the current offset if it is the same as the given applied one.
+// The hash only rules out most changed sections cheaply. The bytes of the section and the data model
+// version are compared to the applied configuration, which is still intact while the staging one is
+// being validated.
+bool SkipUnchangedConfigSection(config_buffer_t *buffer, const config_section_t *section, uint16_t context)
+{
+    if (section->length == 0 || section->offset != buffer->offset || section->context != context) {
+        return false;
+    }
+    if (hashConfigSection(buffer, section->offset, section->length, context) != section->hash) {
+        return false;
+    }
+    if (buffer->buffer != ValidatedUserConfigBuffer.buffer && (
+            memcmp(buffer->buffer, ValidatedUserConfigBuffer.buffer, sizeof(uint16_t)) != 0 ||
+            memcmp(buffer->buffer + section->offset, ValidatedUserConfigBuffer.buffer + section->offset, section->length) != 0
+    )) {
+        return false;
+    }
+    buffer->offset += section->length;
+    return true;
+}
+
+config_section_t ConfigSectionSince(config_buffer_t *buffer, uint16_t offset, uint16_t context)
+{
+    uint16_t length = buffer->offset - offset;
+    return (config_section_t) {
+        .offset = offset,
+        .length = length,
+        .hash = hashConfigSection(buffer, offset, length, context),
+        .context = context,
+    };
+}
+
 static parser_error_t parseModuleConfiguration(config_buffer_t *buffer)
 {
     uint8_t id = ReadUInt8(buffer);
@@ -93,31 +153,46 @@ parser_error_t ParseConfig(config_buffer_t *buffer)
 
     // Module configurations
 
-    uint16_t moduleConfigurationCount = ReadCompactLength(buffer);
+    config_section_t stagingModuleConfigurationsSection = moduleConfigurationsSection;
+    uint16_t moduleConfigurationsOffset = buffer->offset;
 
-    if (moduleConfigurationCount > 255) {
-        return ParserError_InvalidModuleConfigurationCount;
-    }
+    if (!SkipUnchangedConfigSection(buffer, &moduleConfigurationsSection, 0)) {
+        uint16_t moduleConfigurationCount = ReadCompactLength(buffer);
 
-    for (uint8_t moduleConfigurationIdx = 0; moduleConfigurationIdx < moduleConfigurationCount; moduleConfigurationIdx++) {
-        errorCode = parseModuleConfiguration(buffer);
-        if (errorCode != ParserError_Success) {
-            return errorCode;
+        if (moduleConfigurationCount > 255) {
+            return ParserError_InvalidModuleConfigurationCount;
+        }
+
+        for (uint8_t moduleConfigurationIdx = 0; moduleConfigurationIdx < moduleConfigurationCount; moduleConfigurationIdx++) {
+            errorCode = parseModuleConfiguration(buffer);
+            if (errorCode != ParserError_Success) {
+                return errorCode;
+            }
         }
+        stagingModuleConfigurationsSection = ConfigSectionSince(buffer, moduleConfigurationsOffset, 0);
     }
 
     // Macros
 
-    macroCount = ReadCompactLength(buffer);
-    if (macroCount > MAX_MACRO_NUM) {
-        return ParserError_InvalidMacroCount;
-    }
+    config_section_t stagingMacrosSection = macrosSection;
+    uint16_t macrosOffset = buffer->offset;
 
-    for (uint8_t macroIdx = 0; macroIdx < macroCount; macroIdx++) {
-        errorCode = ParseMacro(buffer, macroIdx);
-        if (errorCode != ParserError_Success) {
-            return errorCode;
+    if (SkipUnchangedConfigSection(buffer, &macrosSection, 0)) {
+        macroCount = AllMacrosCount;
+        memcpy(StagingMacros, AllMacros, macroCount * sizeof *AllMacros);
+    } else {
+        macroCount = ReadCompactLength(buffer);
+        if (macroCount > MAX_MACRO_NUM) {
+            return ParserError_InvalidMacroCount;
+        }
+
+        for (uint8_t macroIdx = 0; macroIdx < macroCount; macroIdx++) {
+            errorCode = ParseMacro(buffer, macroIdx);
+            if (errorCode != ParserError_Success) {
+                return errorCode;
+            }
         }
+        stagingMacrosSection = ConfigSectionSince(buffer, macrosOffset, 0);
     }
 
     // Keymaps
@@ -134,40 +209,82 @@ parser_error_t ParseConfig(config_buffer_t *buffer)
         }
     }
 
-    // If parsing succeeded then apply the parsed values.
+    // Parsing succeeded, so stage the parsed values to be applied.
+
+    StagingConfig = (staging_config_t) {
+        .userConfigLength = userConfigLength,
+        .iconsAndLayerTextsBrightness = iconsAndLayerTextsBrightness,
+        .alphanumericSegmentsBrightness = alphanumericSegmentsBrightness,
+        .keyBacklightBrightness = keyBacklightBrightness,
+        .mouseMoveInitialSpeed = mouseMoveInitialSpeed,
+        .mouseMoveAcceleration = mouseMoveAcceleration,
+        .mouseMoveDeceleratedSpeed = mouseMoveDeceleratedSpeed,
+        .mouseMoveBaseSpeed = mouseMoveBaseSpeed,
+        .mouseMoveAcceleratedSpeed = mouseMoveAcceleratedSpeed,
+        .mouseScrollInitialSpeed = mouseScrollInitialSpeed,
+        .mouseScrollAcceleration = mouseScrollAcceleration,
+        .mouseScrollDeceleratedSpeed = mouseScrollDeceleratedSpeed,
+        .mouseScrollBaseSpeed = mouseScrollBaseSpeed,
+        .mouseScrollAcceleratedSpeed = mouseScrollAcceleratedSpeed,
+        .keymapCount = keymapCount,
+        .macroCount = macroCount,
+        .defaultKeymapIndex = StagingConfig.defaultKeymapIndex,
+        .moduleConfigurationsSection = stagingModuleConfigurationsSection,
+        .macrosSection = stagingMacrosSection,
+    };
 
-    if (!ParserRunDry) {
-//        DoubleTapSwitchLayerTimeout = doubleTapSwitchLayerTimeout;
+    return ParserError_Success;
+}
 
-        // Update LED brightnesses and reinitialize LED drivers
+// Makes the last successfully parsed configuration the current one. Returns whether the macros have changed.
+bool ApplyStagingConfig(void)
+{
+    bool macrosChanged = !ConfigSectionsEqual(&macrosSection, &StagingConfig.macrosSection);
 
-        ValidatedUserConfigLength = userConfigLength;
+//    DoubleTapSwitchLayerTimeout = doubleTapSwitchLayerTimeout;
 
-        IconsAndLayerTextsBrightnessDefault = iconsAndLayerTextsBrightness;
-        AlphanumericSegmentsBrightnessDefault = alphanumericSegmentsBrightness;
-        KeyBacklightBrightnessDefault = keyBacklightBrightness;
+    // Swap in the keymap and macro references
 
-        LedSlaveDriver_UpdateLeds();
+    keymap_reference_t *keymaps = AllKeymaps;
+    AllKeymaps = StagingKeymaps;
+    StagingKeymaps = keymaps;
 
-        // Update mouse key speeds
+    macro_reference_t *macros = AllMacros;
+    AllMacros = StagingMacros;
+    StagingMacros = macros;
 
-        MouseMoveState.initialSpeed = mouseMoveInitialSpeed;
-        MouseMoveState.acceleration = mouseMoveAcceleration;
-        MouseMoveState.deceleratedSpeed = mouseMoveDeceleratedSpeed;
-        MouseMoveState.baseSpeed = mouseMoveBaseSpeed;
-        MouseMoveState.acceleratedSpeed = mouseMoveAcceleratedSpeed;
+    // Update LED brightnesses and reinitialize LED drivers
 
-        MouseScrollState.initialSpeed = mouseScrollInitialSpeed;
-        MouseScrollState.acceleration = mouseScrollAcceleration;
-        MouseScrollState.deceleratedSpeed = mouseScrollDeceleratedSpeed;
-        MouseScrollState.baseSpeed = mouseScrollBaseSpeed;
-        MouseScrollState.acceleratedSpeed = mouseScrollAcceleratedSpeed;
+    ValidatedUserConfigLength = StagingConfig.userConfigLength;
 
-        // Update counts
+    IconsAndLayerTextsBrightnessDefault = StagingConfig.iconsAndLayerTextsBrightness;
+    AlphanumericSegmentsBrightnessDefault = StagingConfig.alphanumericSegmentsBrightness;
+    KeyBacklightBrightnessDefault = StagingConfig.keyBacklightBrightness;
 
-        AllKeymapsCount = keymapCount;
-        AllMacrosCount = macroCount;
-    }
+    LedSlaveDriver_UpdateLeds();
 
-    return ParserError_Success;
+    // Update mouse key speeds
+
+    MouseMoveState.initialSpeed = StagingConfig.mouseMoveInitialSpeed;
+    MouseMoveState.acceleration = StagingConfig.mouseMoveAcceleration;
+    MouseMoveState.deceleratedSpeed = StagingConfig.mouseMoveDeceleratedSpeed;
+    MouseMoveState.baseSpeed = StagingConfig.mouseMoveBaseSpeed;
+    MouseMoveState.acceleratedSpeed = StagingConfig.mouseMoveAcceleratedSpeed;
+
+    MouseScrollState.initialSpeed = StagingConfig.mouseScrollInitialSpeed;
+    MouseScrollState.acceleration = StagingConfig.mouseScrollAcceleration;
+    MouseScrollState.deceleratedSpeed = StagingConfig.mouseScrollDeceleratedSpeed;
+    MouseScrollState.baseSpeed = StagingConfig.mouseScrollBaseSpeed;
+    MouseScrollState.acceleratedSpeed = StagingConfig.mouseScrollAcceleratedSpeed;
+
+    // Update counts
+
+    AllKeymapsCount = StagingConfig.keymapCount;
+    AllMacrosCount = StagingConfig.macroCount;
+    DefaultKeymapIndex = StagingConfig.defaultKeymapIndex;
+
+    moduleConfigurationsSection = StagingConfig.moduleConfigurationsSection;
+    macrosSection = StagingConfig.macrosSection;
+
+    return macrosChanged;
 }
@@ -26,6 +26,32 @@
         ParserError_InvalidLayerId                      = 15,
     } parser_error_t;
 
+    // Values of a validated configuration which are yet to be applied.
+    typedef struct {
+        uint16_t userConfigLength;
+        uint8_t iconsAndLayerTextsBrightness;
+        uint8_t alphanumericSegmentsBrightness;
+        uint8_t keyBacklightBrightness;
+        uint8_t mouseMoveInitialSpeed;
+        uint8_t mouseMoveAcceleration;
+        uint8_t mouseMoveDeceleratedSpeed;
+        uint8_t mouseMoveBaseSpeed;
+        uint8_t mouseMoveAcceleratedSpeed;
+        uint8_t mouseScrollInitialSpeed;
+        uint8_t mouseScrollAcceleration;
+        uint8_t mouseScrollDeceleratedSpeed;
+        uint8_t mouseScrollBaseSpeed;
+        uint8_t mouseScrollAcceleratedSpeed;
+        uint8_t keymapCount;
+        uint8_t macroCount;
+        uint8_t defaultKeymapIndex;
+        config_section_t moduleConfigurationsSection;
+        config_section_t macrosSection;
+    } staging_config_t;
+
+// Variables:
+
+    extern staging_config_t StagingConfig;
     extern uint16_t DataModelMajorVersion;
     extern uint16_t DataModelMinorVersion;
     extern uint16_t DataModelPatchVersion;
@@ -33,5 +59,9 @@
 // Functions:
 
     parser_error_t ParseConfig(config_buffer_t *buffer);
+    bool ApplyStagingConfig(void);
+    bool ConfigSectionsEqual(const config_section_t *a, const config_section_t *b);
+    bool SkipUnchangedConfigSection(config_buffer_t *buffer, const config_section_t *section, uint16_t context);
+    config_section_t ConfigSectionSince(config_buffer_t *buffer, uint16_t offset, uint16_t context);
 
 #endif
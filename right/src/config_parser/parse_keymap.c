@@ -203,16 +203,26 @@ parser_error_t ParseKeymap(config_buffer_t *buffer, uint8_t keymapIdx, uint8_t k
     if (layerCount > LayerId_Count) {
         return ParserError_InvalidLayerCount;
     }
-    if (!ParserRunDry) {
-        AllKeymaps[keymapIdx].abbreviation = abbreviation;
-        AllKeymaps[keymapIdx].abbreviationLen = abbreviationLen;
-        AllKeymaps[keymapIdx].offset = offset;
+    uint16_t sectionContext = keymapCount << 8 | macroCount;
+    if (ParserRunDry) {
+        StagingKeymaps[keymapIdx].abbreviation = abbreviation;
+        StagingKeymaps[keymapIdx].abbreviationLen = abbreviationLen;
+        StagingKeymaps[keymapIdx].offset = offset;
+        if (isDefault) {
+            StagingConfig.defaultKeymapIndex = keymapIdx;
+        }
+        // A keymap which is the same as the applied one of the same index needs no validation.
+        uint16_t layersOffset = buffer->offset;
+        buffer->offset = offset;
+        if (keymapIdx < AllKeymapsCount && SkipUnchangedConfigSection(buffer, &AllKeymaps[keymapIdx].section, sectionContext)) {
+            StagingKeymaps[keymapIdx].section = AllKeymaps[keymapIdx].section;
+            return ParserError_Success;
+        }
+        buffer->offset = layersOffset;
+    } else {
         for (uint8_t layerIdx = 0; layerIdx < LayerId_Count; layerIdx++) {
             LayerConfig[layerIdx].layerIsDefined = false;
         }
-        if (isDefault) {
-            DefaultKeymapIndex = keymapIdx;
-        }
     }
     tempKeymapCount = keymapCount;
     tempMacroCount = macroCount;
@@ -222,5 +232,8 @@ parser_error_t ParseKeymap(config_buffer_t *buffer, uint8_t keymapIdx, uint8_t k
             return errorCode;
         }
     }
+    if (ParserRunDry) {
+        StagingKeymaps[keymapIdx].section = ConfigSectionSince(buffer, offset, sectionContext);
+    }
     return ParserError_Success;
 }
@@ -202,11 +202,9 @@ parser_error_t ParseMacro(config_buffer_t *buffer, uint8_t macroIdx)
     (void)isLooped;
     (void)isPrivate;
     (void)name;
-    if (!ParserRunDry) {
-        AllMacros[macroIdx].firstMacroActionOffset = firstMacroActionOffset;
-        AllMacros[macroIdx].macroActionsCount = macroActionsCount;
-        AllMacros[macroIdx].macroNameOffset = relativeNameOffset;
-    }
+    StagingMacros[macroIdx].firstMacroActionOffset = firstMacroActionOffset;
+    StagingMacros[macroIdx].macroActionsCount = macroActionsCount;
+    StagingMacros[macroIdx].macroNameOffset = relativeNameOffset;
     for (uint16_t i = 0; i < macroActionsCount; i++) {
         errorCode = ParseMacroAction(buffer, &dummyMacroAction);
         if (errorCode != ParserError_Success) {
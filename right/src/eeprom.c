@@ -5,12 +5,14 @@
 #include "eeprom.h"
 #include "config_parser/config_globals.h"
 #include "buffer.h"
+#include "timer.h"
 
 volatile bool IsEepromBusy;
 static eeprom_operation_t CurrentEepromOperation;
 static config_buffer_id_t CurrentConfigBufferId;
 static status_t LastEepromTransferStatus;
 void (*SuccessCallback)(void);
+eeprom_write_stats_t EepromWriteStats;
 
 static i2c_master_handle_t i2cHandle;
 static i2c_master_transfer_t i2cTransfer;
@@ -21,6 +23,87 @@ static uint16_t eepromStartAddress;
 static uint16_t sourceLength;
 static uint8_t writeLength;
 static bool isReadSent;
+static uint16_t readOffset;
+static uint16_t readLength;
+static uint64_t writtenPageHash;
+static uint32_t writeStartTime;
+
+// Hashes of the pages as they are stored on the EEPROM, known for the pages which have been read or written.
+// This is the only page hash table; config_globals.c takes the hashes of buffer pages which are in sync with
+// the EEPROM from here.
+static uint64_t pageHashes[EEPROM_PAGE_COUNT];
+static uint8_t knownPageHashes[EEPROM_PAGE_COUNT / 8];
+
+static void setPageHash(uint16_t pageIdx, uint64_t hash)
+{
+    pageHashes[pageIdx] = hash;
+    knownPageHashes[pageIdx / 8] |= 1 << (pageIdx % 8);
+}
+
+static void forgetPageHash(uint16_t pageIdx)
+{
+    knownPageHashes[pageIdx / 8] &= ~(1 << (pageIdx % 8));
+}
+
+bool EEPROM_GetPageHash(uint16_t pageIdx, uint64_t *hash)
+{
+    if (!(knownPageHashes[pageIdx / 8] & (1 << (pageIdx % 8)))) {
+        return false;
+    }
+    *hash = pageHashes[pageIdx];
+    return true;
+}
+
+static void recordReadPages(const uint8_t *buffer, uint16_t offset, uint16_t length)
+{
+    for (uint16_t pageOffset = offset; pageOffset < offset + length; pageOffset += EEPROM_PAGE_SIZE) {
+        setPageHash((eepromStartAddress + pageOffset) / EEPROM_PAGE_SIZE, ConfigBuffer_HashPage(buffer + pageOffset));
+    }
+    ConfigBuffer_MarkInSyncWithEeprom(buffer, offset, length);
+}
+
+// Only the part of the user configuration buffer which is in use gets read.
+static uint16_t userConfigReadLength(uint8_t *userConfig)
+{
+    config_buffer_t header = { .buffer = userConfig, .offset = USER_CONFIG_LENGTH_OFFSET };
+    uint16_t userConfigLength = ReadUInt16(&header);
+    if (userConfigLength == 0 || userConfigLength > USER_CONFIG_SIZE) {
+        return USER_CONFIG_SIZE;
+    }
+    return (userConfigLength + EEPROM_PAGE_SIZE - 1) / EEPROM_PAGE_SIZE * EEPROM_PAGE_SIZE;
+}
+
+static uint16_t currentPageIdx(void)
+{
+    return (eepromStartAddress + sourceOffset) / EEPROM_PAGE_SIZE;
+}
+
+// Skips the pages whose content is already on the EEPROM. Returns false if no page is left to be written.
+static bool findNextChangedPage(void)
+{
+    while (sourceOffset < sourceLength) {
+        if (!ConfigBuffer_IsPageInSyncWithEeprom(sourceBuffer, sourceOffset)) {
+            uint64_t storedPageHash;
+            writtenPageHash = ConfigBuffer_HashPage(sourceBuffer + sourceOffset);
+            if (!EEPROM_GetPageHash(currentPageIdx(), &storedPageHash) || storedPageHash != writtenPageHash) {
+                return true;
+            }
+            ConfigBuffer_MarkInSyncWithEeprom(sourceBuffer, sourceOffset, EEPROM_PAGE_SIZE);
+        }
+        EepromWriteStats.skippedPageCount++;
+        sourceOffset += EEPROM_PAGE_SIZE;
+    }
+    return false;
+}
+
+static void finishWrite(void)
+{
+    EepromWriteStats.duration = CurrentTime - writeStartTime;
+    IsEepromBusy = false;
+    if (SuccessCallback) {
+        SuccessCallback();
+    }
+}
 
 static status_t i2cAsyncWrite(uint8_t *data, size_t dataSize)
 {
@@ -40,6 +123,19 @@ static status_t i2cAsyncRead(uint8_t *data, size_t dataSize)
     return I2C_MasterTransferNonBlocking(I2C_EEPROM_BUS_BASEADDR, &i2cHandle, &i2cTransfer);
 }
 
+static status_t sendAddress(uint16_t address)
+{
+    static uint8_t addressBuffer[EEPROM_ADDRESS_SIZE];
+    SetBufferUint16Be(addressBuffer, 0, address);
+    return i2cAsyncWrite(addressBuffer, EEPROM_ADDRESS_SIZE);
+}
+
+static status_t sendReadAddress(void)
+{
+    isReadSent = false;
+    return sendAddress(eepromStartAddress + readOffset);
+}
+
 static status_t writePage(void)
 {
     static uint8_t buffer[EEPROM_BUFFER_SIZE];
@@ -55,30 +151,52 @@ static void i2cCallback(I2C_Type *base, i2c_master_handle_t *handle, status_t st
     LastEepromTransferStatus = status;
 
     switch (CurrentEepromOperation) {
-        case EepromOperation_Read:
-            if (isReadSent) {
-                IsEepromBusy = false;
-                if (SuccessCallback) {
-                    SuccessCallback();
+        case EepromOperation_Read: {
+            uint8_t *buffer = ConfigBufferIdToConfigBuffer(CurrentConfigBufferId)->buffer;
+            if (!isReadSent) {
+                LastEepromTransferStatus = i2cAsyncRead(buffer + readOffset, readLength);
+                IsEepromBusy = true;
+                isReadSent = true;
+                break;
+            }
+            ConfigBuffer_MarkChanged(buffer, readOffset, readLength);
+            if (status == kStatus_Success) {
+                recordReadPages(buffer, readOffset, readLength);
+                // Having read the first page of the user configuration, read the rest of it.
+                if (CurrentConfigBufferId != ConfigBufferId_HardwareConfig && readOffset == 0) {
+                    uint16_t userConfigLength = userConfigReadLength(buffer);
+                    if (userConfigLength > readLength) {
+                        readOffset = readLength;
+                        readLength = userConfigLength - readOffset;
+                        LastEepromTransferStatus = sendReadAddress();
+                        IsEepromBusy = LastEepromTransferStatus == kStatus_Success;
+                        break;
+                    }
                 }
-                return;
             }
-            LastEepromTransferStatus = i2cAsyncRead(
-                ConfigBufferIdToConfigBuffer(CurrentConfigBufferId)->buffer,
-                CurrentConfigBufferId == ConfigBufferId_HardwareConfig ? HARDWARE_CONFIG_SIZE : USER_CONFIG_SIZE
-            );
-            IsEepromBusy = true;
-            isReadSent = true;
-            break;
+            IsEepromBusy = false;
+            if (SuccessCallback) {
+                SuccessCallback();
+            }
+            return;
+        }
         case EepromOperation_Write:
+            // No page has changed, and only the address has been sent.
+            if (sourceOffset >= sourceLength) {
+                finishWrite();
+                return;
+            }
             if (status == kStatus_Success) {
+                setPageHash(currentPageIdx(), writtenPageHash);
+                ConfigBuffer_MarkInSyncWithEeprom(sourceBuffer, sourceOffset, EEPROM_PAGE_SIZE);
+                EepromWriteStats.writtenPageCount++;
                 sourceOffset += writeLength;
+            } else {
+                forgetPageHash(currentPageIdx());
+                ConfigBuffer_MarkEepromChanged(sourceBuffer, sourceOffset, EEPROM_PAGE_SIZE);
             }
-            IsEepromBusy = sourceOffset < sourceLength;
-            if (!IsEepromBusy) {
-                if (SuccessCallback) {
-                    SuccessCallback();
-                }
+            if (!findNextChangedPage()) {
+                finishWrite();
                 return;
             }
             LastEepromTransferStatus = writePage();
@@ -109,17 +227,22 @@ status_t EEPROM_LaunchTransfer(eeprom_operation_t operation, config_buffer_id_t
 
     switch (CurrentEepromOperation) {
         case EepromOperation_Read:
-            isReadSent = false;
-            static uint8_t addressBuffer[EEPROM_ADDRESS_SIZE];
-            SetBufferUint16Be(addressBuffer, 0, eepromStartAddress);
-            LastEepromTransferStatus = i2cAsyncWrite(addressBuffer, EEPROM_ADDRESS_SIZE);
+            readOffset = 0;
+            readLength = isHardwareConfig ? HARDWARE_CONFIG_SIZE : EEPROM_PAGE_SIZE;
+            LastEepromTransferStatus = sendReadAddress();
             break;
         case EepromOperation_Write:
             sourceBuffer = ConfigBufferIdToConfigBuffer(CurrentConfigBufferId)->buffer;
             sourceOffset = 0;
             uint16_t userConfigSize = ValidatedUserConfigLength && configBufferId == ConfigBufferId_ValidatedUserConfig ? ValidatedUserConfigLength : USER_CONFIG_SIZE;
             sourceLength = isHardwareConfig ? HARDWARE_CONFIG_SIZE : userConfigSize;
-            LastEepromTransferStatus = writePage();
+            // Whole pages are written, so that the CRC of every written page is known.
+            sourceLength = (sourceLength + EEPROM_PAGE_SIZE - 1) / EEPROM_PAGE_SIZE * EEPROM_PAGE_SIZE;
+            EepromWriteStats = (eeprom_write_stats_t) { 0 };
+            writeStartTime = CurrentTime;
+            // Without a changed page, an address is sent nevertheless, so that the write completes
+            // through i2cCallback like any other transfer.
+            LastEepromTransferStatus = findNextChangedPage() ? writePage() : sendAddress(eepromStartAddress);
             break;
     }
 
@@ -14,6 +14,10 @@
     #define EEPROM_ADDRESS_SIZE 2
     #define EEPROM_PAGE_SIZE 64
     #define EEPROM_BUFFER_SIZE (EEPROM_ADDRESS_SIZE + EEPROM_PAGE_SIZE)
+    #define EEPROM_PAGE_COUNT (EEPROM_SIZE / EEPROM_PAGE_SIZE)
+
+    // Offset of the length field within the header of the user configuration
+    #define USER_CONFIG_LENGTH_OFFSET 6
 
 // Typedefs:
 
@@ -22,13 +26,21 @@
         EepromOperation_Write,
     } eeprom_operation_t;
 
+    typedef struct {
+        uint16_t writtenPageCount;
+        uint16_t skippedPageCount;
+        uint32_t duration;
+    } eeprom_write_stats_t;
+
 // Variables:
 
     extern volatile bool IsEepromBusy;
+    extern eeprom_write_stats_t EepromWriteStats;
 
 // Functions:
 
     void EEPROM_Init(void);
+    bool EEPROM_GetPageHash(uint16_t pageIdx, uint64_t *hash);
     status_t EEPROM_LaunchTransfer(eeprom_operation_t operation, config_buffer_id_t config_buffer_id, void (*successCallback));
     bool IsEepromOperationValid(eeprom_operation_t operation);
 
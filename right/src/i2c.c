@@ -1,8 +1,19 @@
 #include "i2c.h"
 #include "crc16.h"
+#include "timer.h"
 
 i2c_master_handle_t I2cMasterHandle;
 i2c_master_transfer_t masterTransfer;
+uint32_t I2cTransferStartTime;
+
+static uint8_t transferSubaddressSize;
+
+static status_t startTransfer(void)
+{
+    I2cTransferStartTime = Timer_GetCurrentTimeMicros();
+    transferSubaddressSize = masterTransfer.subaddressSize;
+    return I2C_MasterTransferNonBlocking(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, &masterTransfer);
+}
 
 status_t I2cAsyncWrite(uint8_t i2cAddress, uint8_t *data, size_t dataSize)
 {
@@ -11,7 +22,7 @@ status_t I2cAsyncWrite(uint8_t i2cAddress, uint8_t *data, size_t dataSize)
     masterTransfer.data = data;
     masterTransfer.dataSize = dataSize;
     I2cMasterHandle.userData = NULL;
-    return I2C_MasterTransferNonBlocking(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, &masterTransfer);
+    return startTransfer();
 }
 
 status_t I2cAsyncWriteMessage(uint8_t i2cAddress, i2c_message_t *message)
@@ -22,7 +33,7 @@ status_t I2cAsyncWriteMessage(uint8_t i2cAddress, i2c_message_t *message)
     masterTransfer.dataSize = I2C_MESSAGE_HEADER_LENGTH + message->length;
     I2cMasterHandle.userData = NULL;
     CRC16_UpdateMessageChecksum(message);
-    return I2C_MasterTransferNonBlocking(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, &masterTransfer);
+    return startTransfer();
 }
 
 status_t I2cAsyncRead(uint8_t i2cAddress, uint8_t *data, size_t dataSize)
@@ -32,7 +43,7 @@ status_t I2cAsyncRead(uint8_t i2cAddress, uint8_t *data, size_t dataSize)
     masterTransfer.data = data;
     masterTransfer.dataSize = dataSize;
     I2cMasterHandle.userData = NULL;
-    return I2C_MasterTransferNonBlocking(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, &masterTransfer);
+    return startTransfer();
 }
 
 status_t I2cAsyncReadMessage(uint8_t i2cAddress, i2c_message_t *message)
@@ -42,5 +53,45 @@ status_t I2cAsyncReadMessage(uint8_t i2cAddress, i2c_message_t *message)
     masterTransfer.data = (uint8_t*)message;
     masterTransfer.dataSize = I2C_MESSAGE_MAX_TOTAL_LENGTH;
     I2cMasterHandle.userData = (void*)1;
-    return I2C_MasterTransferNonBlocking(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, &masterTransfer);
+    return startTransfer();
+}
+
+// Writes the request and reads the response in a single transfer, separated by a repeated
+// start instead of a stop. The request is sent as the subaddress, so it must fit into its
+// four bytes, which holds for messages with a single byte of payload.
+status_t I2cAsyncWriteReadMessage(uint8_t i2cAddress, i2c_message_t *txMessage, i2c_message_t *rxMessage)
+{
+    uint8_t txSize = I2C_MESSAGE_HEADER_LENGTH + txMessage->length;
+    if (txSize > I2C_MAX_SUBADDRESS_SIZE) {
+        return kStatus_InvalidArgument;
+    }
+
+    CRC16_UpdateMessageChecksum(txMessage);
+    uint32_t subaddress = 0;
+    for (uint8_t i = 0; i < txSize; i++) {
+        subaddress = subaddress << 8 | ((uint8_t*)txMessage)[i]; // Sent most significant byte first
+    }
+
+    masterTransfer.slaveAddress = i2cAddress;
+    masterTransfer.direction = kI2C_Read;
+    masterTransfer.subaddress = subaddress;
+    masterTransfer.subaddressSize = txSize;
+    masterTransfer.data = (uint8_t*)rxMessage;
+    masterTransfer.dataSize = I2C_MESSAGE_MAX_TOTAL_LENGTH;
+    I2cMasterHandle.userData = (void*)1;
+    status_t status = startTransfer();
+    masterTransfer.subaddressSize = 0;
+    return status;
+}
+
+// Returns the number of bytes moved by the last transfer. Message reads end after the length
+// announced by the slave, so the header of the received message is consulted for them.
+uint16_t I2cGetTransferByteCount(void)
+{
+    uint16_t dataSize = masterTransfer.dataSize;
+    if (I2cMasterHandle.userData) {
+        i2c_message_t *message = (i2c_message_t*)masterTransfer.data;
+        dataSize = MIN(I2C_MESSAGE_HEADER_LENGTH + message->length, I2C_MESSAGE_MAX_TOTAL_LENGTH);
+    }
+    return transferSubaddressSize + dataSize;
 }
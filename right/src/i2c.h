@@ -13,9 +13,13 @@
     #define I2C_MAIN_BUS_BASEADDR         I2C0
     #define I2C_MAIN_BUS_IRQ_ID           I2C0_IRQn
     #define I2C_MAIN_BUS_CLK_SRC          I2C0_CLK_SRC
+    #define I2C_MAIN_BUS_FAST_MODE_PLUS_BAUD_RATE 1000000
+    #define I2C_MAIN_BUS_FAST_MODE_BAUD_RATE 400000
     #define I2C_MAIN_BUS_NORMAL_BAUD_RATE 100000
     #define I2C_MAIN_BUS_BUSPAL_BAUD_RATE 30000
+    #define I2C_MAIN_BUS_BUSPAL_MAX_BAUD_RATE 100000 // Upper bound of the speed requested by the host via BusPal
     #define I2C_MAIN_BUS_MUX              kPORT_MuxAlt7
+    #define I2C_MAX_SUBADDRESS_SIZE       4 // The subaddress of i2c_master_transfer_t is an uint32_t
 
     #define I2C_MAIN_BUS_SDA_GPIO  GPIOD
     #define I2C_MAIN_BUS_SDA_PORT  PORTD
@@ -48,6 +52,7 @@
 // Variables:
 
     extern i2c_master_handle_t I2cMasterHandle;
+    extern uint32_t I2cTransferStartTime; // in microseconds
 
 // Functions:
 
@@ -55,5 +60,7 @@
     status_t I2cAsyncRead(uint8_t i2cAddress, uint8_t *data, size_t dataSize);
     status_t I2cAsyncWriteMessage(uint8_t i2cAddress, i2c_message_t *message);
     status_t I2cAsyncReadMessage(uint8_t i2cAddress, i2c_message_t *message);
+    status_t I2cAsyncWriteReadMessage(uint8_t i2cAddress, i2c_message_t *txMessage, i2c_message_t *rxMessage);
+    uint16_t I2cGetTransferByteCount(void);
 
 #endif
@@ -17,9 +17,19 @@
 #include "bootloader/wormhole.h"
 
 bool IsBusPalOn;
-volatile uint32_t I2cMainBusRequestedBaudRateBps = I2C_MAIN_BUS_NORMAL_BAUD_RATE;
+volatile uint32_t I2cMainBusRequestedBaudRateBps = I2C_MAIN_BUS_FAST_MODE_PLUS_BAUD_RATE;
 volatile uint32_t I2cMainBusActualBaudRateBps;
 
+// Rates which the slave scheduler steps through per slave. The requested rate caps all of them.
+const uint32_t I2cMainBusBaudRates[I2C_MAIN_BUS_BAUD_RATE_COUNT] = {
+    I2C_MAIN_BUS_FAST_MODE_PLUS_BAUD_RATE,
+    I2C_MAIN_BUS_FAST_MODE_BAUD_RATE,
+    I2C_MAIN_BUS_NORMAL_BAUD_RATE,
+};
+
+// Precomputed frequency divider register values of the above rates
+static uint8_t i2cMainBusBaudRateRegisters[I2C_MAIN_BUS_BAUD_RATE_COUNT];
+
 static i2c_bus_t i2cMainBus = {
     .baseAddr = I2C_MAIN_BUS_BASEADDR,
     .clockSrc = I2C_MAIN_BUS_CLK_SRC,
@@ -126,10 +136,26 @@ static void initI2cBus(i2c_bus_t *i2cBus)
     I2C_MasterInit(i2cBus->baseAddr, &masterConfig, sourceClock);
 
     if (i2cBus == &i2cMainBus) {
+        for (uint8_t i = 0; i < I2C_MAIN_BUS_BAUD_RATE_COUNT; i++) {
+            I2C_MasterSetBaudRate(i2cBus->baseAddr, GetI2cMainBusBaudRate(i), sourceClock);
+            i2cMainBusBaudRateRegisters[i] = i2cBus->baseAddr->F;
+        }
+        I2C_MasterSetBaudRate(i2cBus->baseAddr, I2cMainBusRequestedBaudRateBps, sourceClock);
         I2cMainBusActualBaudRateBps = I2C_ActualBaudRate;
     }
 }
 
+uint32_t GetI2cMainBusBaudRate(uint8_t baudRateIdx)
+{
+    return MIN(I2cMainBusBaudRates[baudRateIdx], I2cMainBusRequestedBaudRateBps);
+}
+
+// Must only be called while the main bus is idle.
+void SetI2cMainBusBaudRate(uint8_t baudRateIdx)
+{
+    I2C_MAIN_BUS_BASEADDR->F = i2cMainBusBaudRateRegisters[baudRateIdx];
+}
+
 void ReinitI2cMainBus(void)
 {
     I2C_MasterDeinit(I2C_MAIN_BUS_BASEADDR);
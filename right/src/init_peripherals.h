@@ -5,8 +5,19 @@
 
     #include "fsl_common.h"
 
+// Macros:
+
+    #define I2C_MAIN_BUS_BAUD_RATE_COUNT 3
+
 // Typedefs:
 
+    // Indexes into I2cMainBusBaudRates
+    typedef enum {
+        I2cMainBusBaudRateIdx_FastModePlus,
+        I2cMainBusBaudRateIdx_FastMode,
+        I2cMainBusBaudRateIdx_Normal,
+    } i2c_main_bus_baud_rate_idx_t;
+
     typedef struct {
         clock_name_t clockSrc;
         I2C_Type *baseAddr;
@@ -28,10 +39,13 @@
     extern bool IsBusPalOn;
     extern volatile uint32_t I2cMainBusRequestedBaudRateBps;
     extern volatile uint32_t I2cMainBusActualBaudRateBps;
+    extern const uint32_t I2cMainBusBaudRates[I2C_MAIN_BUS_BAUD_RATE_COUNT];
 
 // Functions:
 
     void InitPeripherals(void);
     void ReinitI2cMainBus(void);
+    void SetI2cMainBusBaudRate(uint8_t baudRateIdx);
+    uint32_t GetI2cMainBusBaudRate(uint8_t baudRateIdx);
 
 #endif
@@ -8,14 +8,20 @@
 #include "macros.h"
 #include "macro_events.h"
 
-keymap_reference_t AllKeymaps[MAX_KEYMAP_NUM] = {
+// The parser fills the staging half, which gets swapped in once the whole configuration is valid.
+static keymap_reference_t keymapReferences[2][MAX_KEYMAP_NUM] = {
     {
-        .abbreviation = "FTY",
-        .offset = 0,
-        .abbreviationLen = 3
+        {
+            .abbreviation = "FTY",
+            .offset = 0,
+            .abbreviationLen = 3
+        }
     }
 };
 
+keymap_reference_t *AllKeymaps = keymapReferences[0];
+keymap_reference_t *StagingKeymaps = keymapReferences[1];
+
 uint8_t AllKeymapsCount;
 uint8_t DefaultKeymapIndex;
 uint8_t CurrentKeymapIndex = 0;
@@ -5,6 +5,7 @@
 
     #include <stdint.h>
     #include "key_action.h"
+    #include "config_parser/basic_types.h"
 
 // Macros:
 
@@ -17,11 +18,13 @@
         const char *abbreviation;
         uint16_t offset;
         uint8_t abbreviationLen;
+        config_section_t section;
     } keymap_reference_t;
 
 // Variables:
 
-    extern keymap_reference_t AllKeymaps[MAX_KEYMAP_NUM];
+    extern keymap_reference_t *AllKeymaps;
+    extern keymap_reference_t *StagingKeymaps;
     extern uint8_t AllKeymapsCount;
     extern uint8_t DefaultKeymapIndex;
     extern uint8_t CurrentKeymapIndex;
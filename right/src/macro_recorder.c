@@ -4,121 +4,216 @@
 #include "timer.h"
 
 /**
- * Coding should be refactored as follows:
- * - first byte header
- *   - 3 bits -> report type/coding style:
- *     delay
- *     basic
- *     basicFollowedByEmpty
- *   - 2 bits:
- *     - no mods
- *     - 1 bit = left shift
- *     - 1 bit = right shift
- *     - both = full mod mask follow
- *   - 3 bits = number of scancodes, 7 = full size follows
- * - further bytes: mod mask and scancodes as specified by header
+ * Recordings are kept as a log in a ring buffer. Every recording occupies one
+ * segment - its uint16 length followed by its records (see macro_recorder.h):
+ * - delta records carry only the scancodes which were pressed or released
+ *   since the previous report, and the modifier mask if it has changed,
+ * - empty records release everything,
+ * - consecutive delays are merged into a single delay record.
+ *
+ * Re-recording a slot just invalidates its header. Stale segments are reclaimed
+ * lazily once they reach the head of the log. When room is needed, live segments
+ * at the head are moved to the tail if enough dead space can be gained that way,
+ * and evicted (oldest first) otherwise.
  */
 
+#define RING(pos) ((pos) & (REPORT_BUFFER_MAX_LENGTH - 1))
+
 bool RuntimeMacroPlaying = false;
 bool RuntimeMacroRecording = false;
 bool RuntimeMacroRecordingBlind = false;
 
 static uint8_t reportBuffer[REPORT_BUFFER_MAX_LENGTH];
-static uint16_t reportBufferLength = 0;
+static uint16_t logHead = 0;
+static uint16_t logUsed = 0;
+static uint16_t deadBytes = 0;
 
 static runtime_macro_header headers[MAX_RUNTIME_MACROS];
-static uint16_t headersLen = 0;
 
 static runtime_macro_header *recordingHeader;
 static runtime_macro_header *playbackHeader;
+// Position within the records of the played segment.
 static uint16_t playbackPosition;
 
+// State of the report as it will be reconstructed by the player.
+static usb_basic_keyboard_report_t recordedReport;
+static bool lastRecordIsDelay;
+static uint16_t lastDelay;
+static uint16_t lastDelayPosition;
+
+static const usb_basic_keyboard_report_t *toggleReference;
+static uint8_t toggledScancodes[MACRO_RECORD_COUNT_MASK];
+static uint8_t toggledCount;
+
 static bool delayActive;
 static uint32_t delayStart;
 
-static void initHeaderSlot(uint16_t id)
+static uint16_t segmentLength(runtime_macro_header *header)
 {
-    recordingHeader = &headers[headersLen];
-    headersLen++;
-    recordingHeader->id = id;
-    recordingHeader->offset = reportBufferLength;
-    recordingHeader->length = 0;
+    return REPORT_BUFFER_SEGMENT_PREFIX_LENGTH + header->length;
 }
 
-static void discardHeaderSlot(uint8_t headerSlot)
+static runtime_macro_header* findHeader(uint16_t id)
 {
-    uint16_t offsetLeft = headers[headerSlot].offset;
-    uint16_t offsetRight = headers[headerSlot].offset + headers[headerSlot].length;
-    uint16_t length = headers[headerSlot].length;
-    uint8_t *leftPtr = &reportBuffer[offsetLeft];
-    uint8_t *rightPtr = &reportBuffer[offsetRight];
-    memcpy(leftPtr, rightPtr, reportBufferLength - offsetRight);
-    reportBufferLength = reportBufferLength - length;
-    memcpy(&headers[headerSlot], &headers[headerSlot+1], (headersLen-headerSlot) * sizeof (*recordingHeader));
-    headersLen = headersLen-1;
-    for (int i = headerSlot; i < headersLen; i++) {
-        headers[i].offset -= length;
+    for (uint8_t i = 0; i < MAX_RUNTIME_MACROS; i++) {
+        if (headers[i].valid && headers[i].id == id) {
+            return &headers[i];
+        }
     }
+    return NULL;
 }
 
-static void discardLastHeaderSlot()
+static runtime_macro_header* findHeaderAt(uint16_t offset)
 {
-    uint8_t headerSlot = headersLen - 1;
-    uint16_t length = headers[headerSlot].length;
-    reportBufferLength = reportBufferLength - length;
-    headersLen = headersLen-1;
+    for (uint8_t i = 0; i < MAX_RUNTIME_MACROS; i++) {
+        if (headers[i].valid && headers[i].offset == offset) {
+            return &headers[i];
+        }
+    }
+    return NULL;
 }
 
-static void resolveRecordingHeader(uint16_t id)
+static runtime_macro_header* findFreeHeader()
 {
-    for (int i = 0; i < headersLen; i++)
-    {
-        if (headers[i].id == id)
-        {
-            discardHeaderSlot(i);
+    for (uint8_t i = 0; i < MAX_RUNTIME_MACROS; i++) {
+        if (!headers[i].valid) {
+            return &headers[i];
+        }
+    }
+    return NULL;
+}
+
+static void invalidateHeader(runtime_macro_header *header)
+{
+    header->valid = false;
+    deadBytes += segmentLength(header);
+}
+
+// Frees the segment at the head of the log. A live segment is either moved
+// to the tail or evicted.
+static bool reclaimHeadSegment(bool relocate)
+{
+    if (logUsed == 0) {
+        return false;
+    }
+
+    uint16_t length = REPORT_BUFFER_SEGMENT_PREFIX_LENGTH + (reportBuffer[logHead] | reportBuffer[RING(logHead + 1)] << 8);
+    runtime_macro_header *header = findHeaderAt(logHead);
+
+    if (header != NULL) {
+        if ((header == recordingHeader && RuntimeMacroRecording) || (header == playbackHeader && RuntimeMacroPlaying)) {
+            return false;
+        }
+        if (relocate && REPORT_BUFFER_MAX_LENGTH - logUsed >= length) {
+            uint16_t tail = logHead + logUsed;
+            for (uint16_t i = 0; i < length; i++) {
+                reportBuffer[RING(tail + i)] = reportBuffer[RING(logHead + i)];
+            }
+            header->offset = RING(tail);
+            logUsed += length;
+            deadBytes += length;
+        } else {
+            invalidateHeader(header);
+        }
+    }
+
+    logHead = RING(logHead + length);
+    logUsed -= length;
+    deadBytes -= length;
+    return true;
+}
+
+static void makeRoomForRecording()
+{
+    while (REPORT_BUFFER_MAX_LENGTH - logUsed < REPORT_BUFFER_MIN_GAP) {
+        bool relocate = REPORT_BUFFER_MAX_LENGTH - logUsed + deadBytes >= REPORT_BUFFER_MIN_GAP;
+        if (!reclaimHeadSegment(relocate)) {
             break;
         }
     }
-    while(headersLen == MAX_RUNTIME_MACROS || reportBufferLength > REPORT_BUFFER_MAX_LENGTH - REPORT_BUFFER_MIN_GAP) {
-        discardHeaderSlot(0);
+}
+
+static bool initRecordingHeader(uint16_t id)
+{
+    runtime_macro_header *oldHeader = findHeader(id);
+    if (oldHeader != NULL) {
+        invalidateHeader(oldHeader);
+    }
+
+    makeRoomForRecording();
+
+    runtime_macro_header *header;
+    while ((header = findFreeHeader()) == NULL) {
+        if (!reclaimHeadSegment(false)) {
+            return false;
+        }
+    }
+    if (REPORT_BUFFER_MAX_LENGTH - logUsed < REPORT_BUFFER_SEGMENT_PREFIX_LENGTH) {
+        return false;
     }
-    initHeaderSlot(id);
+
+    *header = (runtime_macro_header) {
+        .id = id,
+        .offset = RING(logHead + logUsed),
+        .length = 0,
+        .valid = true,
+    };
+    logUsed += REPORT_BUFFER_SEGMENT_PREFIX_LENGTH;
+    recordingHeader = header;
+    return true;
+}
+
+static void discardRecording()
+{
+    logUsed -= segmentLength(recordingHeader);
+    recordingHeader->valid = false;
 }
 
 static bool resolvePlaybackHeader(uint16_t id)
 {
-    for (int i = 0; i < headersLen; i++)
-    {
-        if (headers[i].id == id)
-        {
-            if (&headers[i] == recordingHeader && RuntimeMacroRecording) {
-                return false;
-            }
-            playbackHeader = &headers[i];
-            return true;
-        }
+    runtime_macro_header *header = findHeader(id);
+
+    if (header == NULL || header->length == 0 || (header == recordingHeader && RuntimeMacroRecording)) {
+        //Macros_ReportErrorNum("Macro slot not found ", id);
+        return false;
     }
-    //Macros_ReportErrorNum("Macro slot not found ", id);
-    return false;
+    playbackHeader = header;
+    return true;
 }
 
 //id is an arbitrary slot identifier
 static void recordRuntimeMacroStart(uint16_t id, bool blind)
 {
-    resolveRecordingHeader(id);
+    if (!initRecordingHeader(id)) {
+        return;
+    }
+    memset(&recordedReport, 0, sizeof recordedReport);
+    lastRecordIsDelay = false;
     RuntimeMacroRecording = true;
     RuntimeMacroRecordingBlind = blind;
     LedDisplay_SetIcon(LedDisplayIcon_Adaptive, true);
 }
 
+static bool reserveRecordSpace(uint16_t length)
+{
+    if (recordingHeader->length + length > REPORT_BUFFER_MAX_MACRO_LENGTH) {
+        return false;
+    }
+    while (REPORT_BUFFER_MAX_LENGTH - logUsed < length) {
+        if (!reclaimHeadSegment(false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static void writeByte(uint8_t b)
 {
-    reportBuffer[reportBufferLength] = b;
-    reportBufferLength++;
+    reportBuffer[RING(recordingHeader->offset + REPORT_BUFFER_SEGMENT_PREFIX_LENGTH + recordingHeader->length)] = b;
     recordingHeader->length++;
+    logUsed++;
 }
 
-
 static void writeUInt16(uint16_t b)
 {
     writeByte(((uint8_t*)&b)[0]);
@@ -127,55 +222,70 @@ static void writeUInt16(uint16_t b)
 
 static void recordRuntimeMacroEnd()
 {
+    if (RuntimeMacroRecording) {
+        reportBuffer[recordingHeader->offset] = ((uint8_t*)&recordingHeader->length)[0];
+        reportBuffer[RING(recordingHeader->offset + 1)] = ((uint8_t*)&recordingHeader->length)[1];
+    }
     RuntimeMacroRecording = false;
     RuntimeMacroRecordingBlind = false;
     LedDisplay_SetIcon(LedDisplayIcon_Adaptive, false);
 }
 
+static void abortRecording()
+{
+    recordRuntimeMacroEnd();
+    discardRecording();
+}
+
 static uint8_t readByte()
 {
-    return reportBuffer[playbackPosition++];
+    return reportBuffer[RING(playbackHeader->offset + REPORT_BUFFER_SEGMENT_PREFIX_LENGTH + playbackPosition++)];
 }
 
 static uint16_t readUInt16()
 {
     uint16_t b;
-    ((uint8_t*)&b)[0] = reportBuffer[playbackPosition++];
-    ((uint8_t*)&b)[1] = reportBuffer[playbackPosition++];
+    ((uint8_t*)&b)[0] = readByte();
+    ((uint8_t*)&b)[1] = readByte();
     return b;
 }
 
+static void toggleScancode(usb_basic_keyboard_report_t *report, uint8_t scancode)
+{
+    if (UsbBasicKeyboard_ContainsScancode(report, scancode)) {
+        UsbBasicKeyboard_RemoveScancode(report, scancode);
+    } else {
+        UsbBasicKeyboard_AddScancode(report, scancode);
+    }
+}
+
 static void playReport(usb_basic_keyboard_report_t *report)
 {
-    macro_report_type_t type = readByte();
-    switch(type) {
-    case BasicKeyboardEmpty:
-        memset(report, 0, sizeof *report);
-        break;
-    case BasicKeyboardSimple:
+    uint16_t recordStart = playbackPosition;
+    uint8_t header = readByte();
+
+    switch (header & MACRO_RECORD_TYPE_MASK) {
+    case MacroRecordType_Empty:
         memset(report, 0, sizeof *report);
-        UsbBasicKeyboard_AddScancode(report, readByte());
         break;
-    case BasicKeyboard:
-        memset(report, 0, sizeof *report);
-        {
-            uint8_t size = readByte();
+    case MacroRecordType_Delta:
+        if (header & MACRO_RECORD_MODIFIERS_FLAG) {
             report->modifiers = readByte();
-            for (int i = 0; i < size; i++) {
-                UsbBasicKeyboard_AddScancode(report, readByte());
-            }
+        }
+        for (uint8_t i = 0; i < (header & MACRO_RECORD_COUNT_MASK); i++) {
+            toggleScancode(report, readByte());
         }
         break;
-    case Delay:
+    case MacroRecordType_Delay:
         {
-            uint16_t timeout = readUInt16();
+            uint16_t timeout = (header & MACRO_RECORD_LONG_DELAY_FLAG) ? readUInt16() : header & MACRO_RECORD_SHORT_DELAY_MASK;
             if (!delayActive) {
                 delayActive = true;
                 delayStart = CurrentTime;
-                playbackPosition -= 3;
+                playbackPosition = recordStart;
             } else {
                 if (Timer_GetElapsedTime(&delayStart) < timeout) {
-                    playbackPosition -= 3;
+                    playbackPosition = recordStart;
                 }
                 else {
                     delayActive = false;
@@ -184,16 +294,18 @@ static void playReport(usb_basic_keyboard_report_t *report)
         }
         break;
     default:
-        Macros_ReportErrorNum("PlayReport decode failed at ", type);
+        Macros_ReportErrorNum("PlayReport decode failed at ", header);
     }
 }
 
-static bool playRuntimeMacroBegin(uint16_t id)
+static bool playRuntimeMacroBegin(uint16_t id, usb_basic_keyboard_report_t* report)
 {
     if (!resolvePlaybackHeader(id)) {
         return false;
     }
-    playbackPosition = playbackHeader->offset;
+    // Records are deltas against an initially empty report.
+    memset(report, 0, sizeof *report);
+    playbackPosition = 0;
     RuntimeMacroPlaying = true;
     return true;
 }
@@ -204,13 +316,24 @@ static bool playRuntimeMacroContinue(usb_basic_keyboard_report_t* report)
         return false;
     }
     playReport(report);
-    RuntimeMacroPlaying = playbackPosition < playbackHeader->offset + playbackHeader->length;
+    RuntimeMacroPlaying = playbackPosition < playbackHeader->length;
     return RuntimeMacroPlaying;
 }
 
-void writeReportScancodes(usb_basic_keyboard_report_t *report)
+static void collectToggledScancode(uint8_t scancode)
+{
+    if (!UsbBasicKeyboard_ContainsScancode(toggleReference, scancode) && toggledCount < MACRO_RECORD_COUNT_MASK) {
+        toggledScancodes[toggledCount++] = scancode;
+    }
+}
+
+static void collectToggledScancodes(usb_basic_keyboard_report_t *report)
 {
-    UsbBasicKeyboard_ForeachScancode(report, &writeByte);
+    toggledCount = 0;
+    toggleReference = &recordedReport;
+    UsbBasicKeyboard_ForeachScancode(report, &collectToggledScancode);
+    toggleReference = report;
+    UsbBasicKeyboard_ForeachScancode(&recordedReport, &collectToggledScancode);
 }
 
 void MacroRecorder_RecordBasicReport(usb_basic_keyboard_report_t *report)
@@ -219,30 +342,41 @@ void MacroRecorder_RecordBasicReport(usb_basic_keyboard_report_t *report)
         return;
     }
 
-    uint8_t sc = UsbBasicKeyboard_ScancodeCount(report);
-
-    if (
-            (reportBufferLength + 3 + sc > REPORT_BUFFER_MAX_LENGTH) ||
-            (recordingHeader->length + 1 > REPORT_BUFFER_MAX_MACRO_LENGTH)
-    ) {
-        recordRuntimeMacroEnd();
-        discardLastHeaderSlot();
+    if (report->modifiers == 0 && UsbBasicKeyboard_ScancodeCount(report) == 0) {
+        if (recordedReport.modifiers == 0 && UsbBasicKeyboard_ScancodeCount(&recordedReport) == 0) {
+            return;
+        }
+        if (!reserveRecordSpace(1)) {
+            abortRecording();
+            return;
+        }
+        writeByte(MacroRecordType_Empty);
+        memset(&recordedReport, 0, sizeof recordedReport);
+        lastRecordIsDelay = false;
         return;
     }
-    if ((report->modifiers == 0) && (sc == 0)) {
-        writeByte(BasicKeyboardEmpty);
+
+    collectToggledScancodes(report);
+    bool modifiersChanged = report->modifiers != recordedReport.modifiers;
+
+    if (toggledCount == 0 && !modifiersChanged) {
         return;
     }
-    if ((report->modifiers == 0) && (sc == 1)) {
-        writeByte(BasicKeyboardSimple);
-        writeReportScancodes(report);
+    if (!reserveRecordSpace(1 + modifiersChanged + toggledCount)) {
+        abortRecording();
         return;
     }
 
-    writeByte(BasicKeyboard);
-    writeByte(sc);
-    writeByte(report->modifiers);
-    writeReportScancodes(report);
+    writeByte(MacroRecordType_Delta | (modifiersChanged ? MACRO_RECORD_MODIFIERS_FLAG : 0) | toggledCount);
+    if (modifiersChanged) {
+        writeByte(report->modifiers);
+        recordedReport.modifiers = report->modifiers;
+    }
+    for (uint8_t i = 0; i < toggledCount; i++) {
+        writeByte(toggledScancodes[i]);
+        toggleScancode(&recordedReport, toggledScancodes[i]);
+    }
+    lastRecordIsDelay = false;
 }
 
 void MacroRecorder_RecordDelay(uint16_t delay)
@@ -250,14 +384,36 @@ void MacroRecorder_RecordDelay(uint16_t delay)
     if (!RuntimeMacroRecording) {
         return;
     }
-    writeByte(Delay);
-    writeUInt16(delay);
+
+    if (lastRecordIsDelay && lastDelay + delay <= UINT16_MAX) {
+        // Replace the preceding delay record by a merged one.
+        uint16_t recordLength = recordingHeader->length - lastDelayPosition;
+        recordingHeader->length -= recordLength;
+        logUsed -= recordLength;
+        delay += lastDelay;
+    }
+
+    bool shortDelay = delay <= MACRO_RECORD_SHORT_DELAY_MASK;
+    if (!reserveRecordSpace(shortDelay ? 1 : 3)) {
+        abortRecording();
+        return;
+    }
+
+    lastRecordIsDelay = true;
+    lastDelay = delay;
+    lastDelayPosition = recordingHeader->length;
+    if (shortDelay) {
+        writeByte(MacroRecordType_Delay | delay);
+    } else {
+        writeByte(MacroRecordType_Delay | MACRO_RECORD_LONG_DELAY_FLAG);
+        writeUInt16(delay);
+    }
 }
 
 bool MacroRecorder_PlayRuntimeMacroSmart(uint16_t id, usb_basic_keyboard_report_t* report)
 {
     if (!RuntimeMacroPlaying) {
-        if (!playRuntimeMacroBegin(id)) {
+        if (!playRuntimeMacroBegin(id, report)) {
             return false;
         }
     }
@@ -13,24 +13,37 @@
 // Macros:
 
     #define MAX_RUNTIME_MACROS 32
+    // Recordings live in a ring buffer, whose length must be a power of two.
     #define REPORT_BUFFER_MAX_LENGTH 2048
     #define REPORT_BUFFER_MAX_MACRO_LENGTH (REPORT_BUFFER_MAX_LENGTH/4)
     #define REPORT_BUFFER_MIN_GAP (REPORT_BUFFER_MAX_LENGTH/4)
-    #define REPORT_BUFFER_SAFETY_MARGIN 11
+    #define REPORT_BUFFER_SEGMENT_PREFIX_LENGTH 2
+
+    // Every record starts with a header byte. Its top two bits give the record type.
+    #define MACRO_RECORD_TYPE_MASK 0xC0
+    // Delta: the modifier mask follows if the flag is set, then the given
+    // number of scancodes whose state toggles.
+    #define MACRO_RECORD_MODIFIERS_FLAG 0x20
+    #define MACRO_RECORD_COUNT_MASK 0x1F
+    // Delay: short delays are stored in the header byte, longer ones follow as uint16.
+    #define MACRO_RECORD_LONG_DELAY_FLAG 0x20
+    #define MACRO_RECORD_SHORT_DELAY_MASK 0x1F
 
 // Typedefs:
 
     typedef enum {
-        BasicKeyboardEmpty,
-        BasicKeyboardSimple,
-        BasicKeyboard,
-        Delay
-    } macro_report_type_t;
+        MacroRecordType_Delta = 0x00,
+        MacroRecordType_Delay = 0x40,
+        MacroRecordType_Empty = 0x80,
+    } macro_record_type_t;
 
+    // Offset is the ring position of the segment that holds the recording;
+    // the segment starts with its uint16 length, followed by the records.
     typedef struct {
         uint16_t id;
         uint16_t offset;
         uint16_t length;
+        bool valid;
     } runtime_macro_header;
 
 // Variables:
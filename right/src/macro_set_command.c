@@ -15,8 +15,11 @@
 #include "mouse_controller.h"
 #include "debug.h"
 #include "caret_config.h"
+#include "combos.h"
+#include "slave_scheduler.h"
 #include "config_parser/parse_macro.h"
 #include "slave_drivers/is31fl3xxx_driver.h"
+#include "slave_drivers/uhk_module_driver.h"
 
 static const char* proceedByDot(const char* cmd, const char *cmdEnd)
 {
@@ -47,12 +50,15 @@ static void moduleSpeed(const char* arg1, const char *textEnd, module_configurat
 
     if (TokenMatches(arg1, textEnd, "baseSpeed")) {
         module->baseSpeed = ParseFloat(arg2, textEnd);
+        module->speedTableValid = false;
     }
     else if (TokenMatches(arg1, textEnd, "speed")) {
         module->speed = ParseFloat(arg2, textEnd);
+        module->speedTableValid = false;
     }
     else if (TokenMatches(arg1, textEnd, "xceleration")) {
         module->xceleration = ParseFloat(arg2, textEnd);
+        module->speedTableValid = false;
     }
     else if (TokenMatches(arg1, textEnd, "caretSpeedDivisor")) {
         module->caretSpeedDivisor = ParseFloat(arg2, textEnd);
@@ -112,6 +118,30 @@ static void module(const char* arg1, const char *textEnd)
     }
 }
 
+static void keyScanPeriod(const char* arg1, const char* arg2, const char *textEnd)
+{
+    uint8_t driverId;
+
+    if (TokenMatches(arg1, textEnd, "leftHalf")) {
+        driverId = UhkModuleDriverId_LeftKeyboardHalf;
+    }
+    else if (TokenMatches(arg1, textEnd, "leftModule")) {
+        driverId = UhkModuleDriverId_LeftModule;
+    }
+    else if (TokenMatches(arg1, textEnd, "rightModule")) {
+        driverId = UhkModuleDriverId_RightModule;
+    }
+    else {
+        Macros_ReportError("parameter not recognized:", arg1, textEnd);
+        return;
+    }
+
+    int32_t scanPeriod = Macros_ParseInt(arg2, textEnd, NULL);
+    scanPeriod = MAX(MODULE_MIN_SCAN_PERIOD_USEC, MIN(scanPeriod, MODULE_MAX_SCAN_PERIOD_USEC));
+    UhkModuleScanPeriods[driverId] = (uint16_t)scanPeriod;
+    UhkModuleStates[driverId].sourceVars.scanPeriod = (uint16_t)scanPeriod;
+}
+
 static void secondaryRoles(const char* arg1, const char *textEnd)
 {
     Macros_ReportError("command not recognized:", arg1, textEnd);
@@ -360,6 +390,44 @@ static void keymapAction(const char* arg1, const char *textEnd)
     *actionSlot = action;
 }
 
+static void combo(const char* arg1, const char *textEnd)
+{
+    uint8_t comboIdx = Macros_ParseInt(arg1, textEnd, NULL);
+    const char* arg = NextTok(arg1, textEnd);
+    key_state_t* keys[COMBO_MAX_KEY_COUNT];
+    uint8_t keyCount = 0;
+
+    if (comboIdx >= COMBO_MAX_COUNT) {
+        Macros_ReportError("invalid combo index:", arg1, textEnd);
+    }
+
+    while (arg < textEnd && *arg >= '0' && *arg <= '9') {
+        uint16_t keyId = Macros_ParseInt(arg, textEnd, NULL);
+        if (keyCount == COMBO_MAX_KEY_COUNT) {
+            Macros_ReportError("too many keys in combo:", arg, textEnd);
+            break;
+        }
+        if(keyId/64 >= SLOT_COUNT || keyId%64 >= MAX_KEY_COUNT_PER_MODULE) {
+            Macros_ReportError("invalid key id:", arg, textEnd);
+            break;
+        }
+        keys[keyCount++] = Utils_KeyIdToKeyState(keyId);
+        arg = NextTok(arg, textEnd);
+    }
+
+    key_action_t action = parseKeyAction(arg, textEnd);
+
+    if (action.type != KeyActionType_None && keyCount < 2) {
+        Macros_ReportError("combo needs at least two keys:", arg1, textEnd);
+    }
+
+    if (Macros_ParserError) {
+        return;
+    }
+
+    Combos_SetCombo(comboIdx, keys, keyCount, action);
+}
+
 static void modLayerTriggers(const char* arg1, const char *textEnd)
 {
     const char* specifier = NextTok(arg1, textEnd);
@@ -449,6 +517,13 @@ macro_result_t MacroSetCommand(const char* arg1, const char *textEnd)
         DebounceTimePress = time;
         DebounceTimeRelease = time;
     }
+    else if (TokenMatches(arg1, textEnd, "i2cProbeMaxInterval")) {
+        int32_t interval = Macros_ParseInt(arg2, textEnd, NULL);
+        SlaveProbeMaxInterval = MAX(SLAVE_PROBE_MIN_MAX_INTERVAL, MIN(interval, SLAVE_PROBE_MAX_MAX_INTERVAL));
+    }
+    else if (TokenMatches(arg1, textEnd, "keyScanPeriod")) {
+        keyScanPeriod(proceedByDot(arg1, textEnd), arg2, textEnd);
+    }
     else if (TokenMatches(arg1, textEnd, "keystrokeDelay")) {
         KeystrokeDelay = Macros_ParseInt(arg2, textEnd, NULL);
     }
@@ -471,6 +546,12 @@ macro_result_t MacroSetCommand(const char* arg1, const char *textEnd)
     else if (TokenMatches(arg1, textEnd, "chordingDelay")) {
         ChordingDelay = Macros_ParseInt(arg2, textEnd, NULL);
     }
+    else if (TokenMatches(arg1, textEnd, "combo")) {
+        combo(proceedByDot(arg1, textEnd), textEnd);
+    }
+    else if (TokenMatches(arg1, textEnd, "comboTimeout")) {
+        ComboTimeout = Macros_ParseInt(arg2, textEnd, NULL);
+    }
     else if (Macros_ExtendedCommands && TokenMatches(arg1, textEnd, "emergencyKey")) {
         uint16_t key = Macros_ParseInt(arg2, textEnd, NULL);
         EmergencyKey = Utils_KeyIdToKeyState(key);
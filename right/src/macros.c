@@ -25,7 +25,9 @@
 #include <stddef.h>
 #include <string.h>
 
-macro_reference_t AllMacros[MAX_MACRO_NUM];
+static macro_reference_t macroReferences[2][MAX_MACRO_NUM];
+macro_reference_t *AllMacros = macroReferences[0];
+macro_reference_t *StagingMacros = macroReferences[1];
 uint8_t AllMacrosCount;
 
 uint8_t MacroBasicScancodeIndex = 0;
@@ -36,9 +38,9 @@ layer_id_t Macros_ActiveLayer = LayerId_Base;
 bool Macros_ActiveLayerHeld = false;
 bool MacroPlaying = false;
 bool Macros_WakedBecauseOfTime = false;
-bool Macros_WakedBecauseOfKeystateChange = false;
 uint32_t Macros_WakeMeOnTime = 0xFFFFFFFF;
 bool Macros_WakeMeOnKeystateChange = false;
+bool Macros_WakeMeOnPostponedKeyEvent = false;
 
 bool Macros_ParserError = false;
 
@@ -57,6 +59,8 @@ static scheduler_state_t scheduler = {
     .activeSlotCount = 0,
     .remainingCount = 0,
 };
+static sleeper_state_t sleepers;
+static macro_output_arena_t outputArena;
 
 static char statusBuffer[STATUS_BUFFER_MAX_LENGTH];
 static uint16_t statusBufferLen;
@@ -79,6 +83,7 @@ uint16_t AutoRepeatInitialDelay = 500;
 uint16_t AutoRepeatDelayRate = 50;
 
 static void wakeMacroInSlot(uint8_t slotIdx);
+static void cancelSleeperWaits(uint8_t slotIdx);
 static void scheduleSlot(uint8_t slotIdx);
 static void unscheduleCurrentSlot();
 static int32_t parseNUM(const char *a, const char *aEnd);
@@ -93,7 +98,8 @@ static bool loadNextAction();
 static void resetToAddressZero(uint8_t macroIndex);
 static uint8_t currentActionCmdCount();
 static macro_result_t sleepTillTime(uint32_t time);
-static macro_result_t sleepTillKeystateChange();
+static macro_result_t sleepTillPostponedKeyEvent();
+static macro_result_t sleepTillKeyChange(key_state_t *keyState);
 
 /**
  * This ensures integration/interface between macro layer mechanism
@@ -121,81 +127,221 @@ void Macros_SignalInterrupt()
     }
 }
 
-static void addBasicScancode(uint8_t scancode)
+static uint8_t allocOutputScancode()
 {
-    if (!scancode) {
-        return;
+    uint8_t entryIdx = outputArena.freeList;
+    if (entryIdx != 0) {
+        outputArena.freeList = outputArena.scancodes[entryIdx - 1].next;
+    } else if (outputArena.untouchedIdx < MACRO_OUTPUT_ARENA_SIZE) {
+        entryIdx = ++outputArena.untouchedIdx;
     }
-    if (!UsbBasicKeyboard_ContainsScancode(&s->ms.macroBasicKeyboardReport, scancode)) {
-        UsbBasicKeyboard_AddScancode(&s->ms.macroBasicKeyboardReport, scancode);
+    return entryIdx;
+}
+
+static void freeOutputScancode(uint8_t *link)
+{
+    uint8_t entryIdx = *link;
+    *link = outputArena.scancodes[entryIdx - 1].next;
+    outputArena.scancodes[entryIdx - 1].next = outputArena.freeList;
+    outputArena.freeList = entryIdx;
+}
+
+static uint8_t* findOutputEntry(macro_state_t *state, uint8_t type)
+{
+    uint8_t *link = &state->ms.outputScancodes;
+    while (*link != 0 && outputArena.scancodes[*link - 1].type != type) {
+        link = &outputArena.scancodes[*link - 1].next;
     }
+    return link;
 }
 
-static void deleteBasicScancode(uint8_t scancode)
+static uint8_t* findOutputScancode(macro_state_t *state, uint16_t scancode, keystroke_type_t type)
+{
+    uint8_t *link = &state->ms.outputScancodes;
+    while (*link != 0) {
+        macro_output_scancode_t *entry = &outputArena.scancodes[*link - 1];
+        if (entry->scancode == scancode && entry->type == type) {
+            break;
+        }
+        link = &entry->next;
+    }
+    return link;
+}
+
+static void addOutputScancode(uint16_t scancode, keystroke_type_t type)
 {
     if (!scancode) {
         return;
     }
-    UsbBasicKeyboard_RemoveScancode(&s->ms.macroBasicKeyboardReport, scancode);
+    uint8_t *link = findOutputScancode(s, scancode, type);
+    if (*link != 0) {
+        return;
+    }
+    uint8_t entryIdx = allocOutputScancode();
+    if (entryIdx == 0) {
+        Macros_ReportErrorNum("Too many scancodes held by macros, dropping ", scancode);
+        return;
+    }
+    outputArena.scancodes[entryIdx - 1] = (macro_output_scancode_t){ .scancode = scancode, .type = type, .next = 0 };
+    *link = entryIdx;
 }
 
-static void addModifiers(uint8_t inputModifiers, uint8_t outputModifiers)
+static void deleteOutputScancode(uint16_t scancode, keystroke_type_t type)
 {
-    s->ms.inputModifierMask |= inputModifiers;
-    s->ms.macroBasicKeyboardReport.modifiers |= outputModifiers;
+    if (!scancode) {
+        return;
+    }
+    uint8_t *link = findOutputScancode(s, scancode, type);
+    if (*link != 0) {
+        freeOutputScancode(link);
+    }
 }
 
-static void deleteModifiers(uint8_t inputModifiers, uint8_t outputModifiers)
+static uint16_t getMouseOutput(macro_output_type_t type)
 {
-    s->ms.inputModifierMask &= ~inputModifiers;
-    s->ms.macroBasicKeyboardReport.modifiers &= ~outputModifiers;
+    uint8_t entryIdx = *findOutputEntry(s, type);
+    return entryIdx == 0 ? 0 : outputArena.scancodes[entryIdx - 1].scancode;
 }
 
-static void addMediaScancode(uint16_t scancode)
+static void setMouseOutput(macro_output_type_t type, uint16_t value)
 {
-    if (!scancode) {
+    uint8_t *link = findOutputEntry(s, type);
+    if (value == 0) {
+        if (*link != 0) {
+            freeOutputScancode(link);
+        }
         return;
     }
-    for (uint8_t i = 0; i < USB_MEDIA_KEYBOARD_MAX_KEYS; i++) {
-        if (s->ms.macroMediaKeyboardReport.scancodes[i] == scancode) {
+    if (*link == 0) {
+        uint8_t entryIdx = allocOutputScancode();
+        if (entryIdx == 0) {
+            Macros_ReportErrorNum("Too many outputs held by macros, dropping mouse output ", type);
             return;
         }
+        outputArena.scancodes[entryIdx - 1] = (macro_output_scancode_t){ .type = type, .next = 0 };
+        *link = entryIdx;
     }
-    for (uint8_t i = 0; i < USB_MEDIA_KEYBOARD_MAX_KEYS; i++) {
-        if (!s->ms.macroMediaKeyboardReport.scancodes[i]) {
-            s->ms.macroMediaKeyboardReport.scancodes[i] = scancode;
-            break;
+    outputArena.scancodes[*link - 1].scancode = value;
+}
+
+static bool outputContainsScancode(uint16_t scancode, keystroke_type_t type)
+{
+    return *findOutputScancode(s, scancode, type) != 0;
+}
+
+static uint8_t outputScancodeCount(keystroke_type_t type)
+{
+    uint8_t count = 0;
+    for (uint8_t entryIdx = s->ms.outputScancodes; entryIdx != 0; entryIdx = outputArena.scancodes[entryIdx - 1].next) {
+        count += outputArena.scancodes[entryIdx - 1].type == type;
+    }
+    return count;
+}
+
+static void clearOutputScancodes(macro_state_t *state, keystroke_type_t type)
+{
+    uint8_t *link = &state->ms.outputScancodes;
+    while (*link != 0) {
+        if (outputArena.scancodes[*link - 1].type == type) {
+            freeOutputScancode(link);
+        } else {
+            link = &outputArena.scancodes[*link - 1].next;
         }
     }
 }
 
-static void deleteMediaScancode(uint16_t scancode)
+static void releaseOutputScancodes(macro_state_t *state)
 {
-    if (!scancode) {
-        return;
+    while (state->ms.outputScancodes != 0) {
+        freeOutputScancode(&state->ms.outputScancodes);
     }
-    for (uint8_t i = 0; i < USB_MEDIA_KEYBOARD_MAX_KEYS; i++) {
-        if (s->ms.macroMediaKeyboardReport.scancodes[i] == scancode) {
-            s->ms.macroMediaKeyboardReport.scancodes[i] = 0;
-            return;
+}
+
+void Macros_MergeOutput(uint8_t slotIdx)
+{
+    macro_state_t *state = &MacroState[slotIdx];
+
+    ActiveUsbBasicKeyboardReport->modifiers |= state->ms.outputModifierMask;
+
+    for (uint8_t entryIdx = state->ms.outputScancodes; entryIdx != 0; entryIdx = outputArena.scancodes[entryIdx - 1].next) {
+        macro_output_scancode_t *entry = &outputArena.scancodes[entryIdx - 1];
+        switch (entry->type) {
+            case KeystrokeType_Basic:
+                if (!UsbBasicKeyboard_ContainsScancode(ActiveUsbBasicKeyboardReport, entry->scancode)) {
+                    UsbBasicKeyboard_AddScancode(ActiveUsbBasicKeyboardReport, entry->scancode);
+                }
+                break;
+            case KeystrokeType_Media:
+                UsbMediaKeyboard_AddScancode(ActiveUsbMediaKeyboardReport, entry->scancode);
+                break;
+            case KeystrokeType_System:
+                UsbSystemKeyboard_AddScancode(ActiveUsbSystemKeyboardReport, entry->scancode);
+                break;
+            case MacroOutputType_MouseButtons:
+                ActiveUsbMouseReport->buttons |= entry->scancode;
+                break;
+            case MacroOutputType_MouseX:
+                PendingMouseMotion.x += (int16_t)entry->scancode;
+                break;
+            case MacroOutputType_MouseY:
+                PendingMouseMotion.y += (int16_t)entry->scancode;
+                break;
+            case MacroOutputType_WheelX:
+                PendingMouseMotion.wheelX += (int8_t)entry->scancode * UsbMouseGetHorizontalWheelMultiplier();
+                break;
+            case MacroOutputType_WheelY:
+                PendingMouseMotion.wheelY += (int8_t)entry->scancode * UsbMouseGetVerticalWheelMultiplier();
+                break;
         }
     }
+
+    // The last report of a finished macro has just been flushed.
+    if (!state->ms.macroPlaying) {
+        releaseOutputScancodes(state);
+        state->ms.outputModifierMask = 0;
+    }
+}
+
+static void addBasicScancode(uint8_t scancode)
+{
+    addOutputScancode(scancode, KeystrokeType_Basic);
+}
+
+static void deleteBasicScancode(uint8_t scancode)
+{
+    deleteOutputScancode(scancode, KeystrokeType_Basic);
+}
+
+static void addModifiers(uint8_t inputModifiers, uint8_t outputModifiers)
+{
+    s->ms.inputModifierMask |= inputModifiers;
+    s->ms.outputModifierMask |= outputModifiers;
+}
+
+static void deleteModifiers(uint8_t inputModifiers, uint8_t outputModifiers)
+{
+    s->ms.inputModifierMask &= ~inputModifiers;
+    s->ms.outputModifierMask &= ~outputModifiers;
+}
+
+static void addMediaScancode(uint16_t scancode)
+{
+    addOutputScancode(scancode, KeystrokeType_Media);
+}
+
+static void deleteMediaScancode(uint16_t scancode)
+{
+    deleteOutputScancode(scancode, KeystrokeType_Media);
 }
 
 static void addSystemScancode(uint8_t scancode)
 {
-    if (!scancode) {
-        return;
-    }
-    UsbSystemKeyboard_AddScancode(&s->ms.macroSystemKeyboardReport, scancode);
+    addOutputScancode(scancode, KeystrokeType_System);
 }
 
 static void deleteSystemScancode(uint8_t scancode)
 {
-    if (!scancode) {
-        return;
-    }
-    UsbSystemKeyboard_RemoveScancode(&s->ms.macroSystemKeyboardReport, scancode);
+    deleteOutputScancode(scancode, KeystrokeType_System);
 }
 
 static void addScancode(uint16_t scancode, keystroke_type_t type)
@@ -311,7 +457,7 @@ static macro_result_t processKey(macro_action_t macro_action)
                 case 3:
                     if (currentMacroKeyIsActive() && action == MacroSubAction_Hold) {
                         s->as.actionPhase--;
-                        return sleepTillKeystateChange();
+                        return sleepTillKeyChange(s->ms.currentMacroKey);
                     }
                     deleteScancode(scancode, type);
                     return MacroResult_Blocking;
@@ -374,14 +520,14 @@ static macro_result_t processMouseButton(macro_action_t macro_action)
         case MacroSubAction_Tap:
             switch(s->as.actionPhase) {
             case 1:
-                s->ms.macroMouseReport.buttons |= mouseButtonMask;
+                setMouseOutput(MacroOutputType_MouseButtons, getMouseOutput(MacroOutputType_MouseButtons) | mouseButtonMask);
                 return MacroResult_Blocking;
             case 2:
                 if (currentMacroKeyIsActive() && action == MacroSubAction_Hold) {
                     s->as.actionPhase--;
-                    return sleepTillKeystateChange();
+                    return sleepTillKeyChange(s->ms.currentMacroKey);
                 }
-                s->ms.macroMouseReport.buttons &= ~mouseButtonMask;
+                setMouseOutput(MacroOutputType_MouseButtons, getMouseOutput(MacroOutputType_MouseButtons) & ~mouseButtonMask);
                 return MacroResult_Blocking;
             case 3:
                 s->as.actionPhase = 0;
@@ -392,7 +538,7 @@ static macro_result_t processMouseButton(macro_action_t macro_action)
         case MacroSubAction_Release:
             switch(s->as.actionPhase) {
             case 1:
-                s->ms.macroMouseReport.buttons &= ~mouseButtonMask;
+                setMouseOutput(MacroOutputType_MouseButtons, getMouseOutput(MacroOutputType_MouseButtons) & ~mouseButtonMask);
                 return MacroResult_Blocking;
             case 2:
                 s->as.actionPhase = 0;
@@ -402,7 +548,7 @@ static macro_result_t processMouseButton(macro_action_t macro_action)
         case MacroSubAction_Press:
             switch(s->as.actionPhase) {
                 case 1:
-                    s->ms.macroMouseReport.buttons |= mouseButtonMask;
+                    setMouseOutput(MacroOutputType_MouseButtons, getMouseOutput(MacroOutputType_MouseButtons) | mouseButtonMask);
                     return MacroResult_Blocking;
                 case 2:
                     s->as.actionPhase = 0;
@@ -422,12 +568,12 @@ static macro_result_t processMoveMouseAction(void)
 {
     s->ms.reportsUsed = true;
     if (s->as.actionActive) {
-        s->ms.macroMouseReport.x = 0;
-        s->ms.macroMouseReport.y = 0;
+        setMouseOutput(MacroOutputType_MouseX, 0);
+        setMouseOutput(MacroOutputType_MouseY, 0);
         s->as.actionActive = false;
     } else {
-        s->ms.macroMouseReport.x = s->ms.currentMacroAction.moveMouse.x;
-        s->ms.macroMouseReport.y = s->ms.currentMacroAction.moveMouse.y;
+        setMouseOutput(MacroOutputType_MouseX, s->ms.currentMacroAction.moveMouse.x);
+        setMouseOutput(MacroOutputType_MouseY, s->ms.currentMacroAction.moveMouse.y);
         s->as.actionActive = true;
     }
     return s->as.actionActive ? MacroResult_Blocking : MacroResult_Finished;
@@ -437,12 +583,12 @@ static macro_result_t processScrollMouseAction(void)
 {
     s->ms.reportsUsed = true;
     if (s->as.actionActive) {
-        s->ms.macroMouseReport.wheelX = 0;
-        s->ms.macroMouseReport.wheelY = 0;
+        setMouseOutput(MacroOutputType_WheelX, 0);
+        setMouseOutput(MacroOutputType_WheelY, 0);
         s->as.actionActive = false;
     } else {
-        s->ms.macroMouseReport.wheelX = s->ms.currentMacroAction.scrollMouse.x;
-        s->ms.macroMouseReport.wheelY = s->ms.currentMacroAction.scrollMouse.y;
+        setMouseOutput(MacroOutputType_WheelX, s->ms.currentMacroAction.scrollMouse.x);
+        setMouseOutput(MacroOutputType_WheelY, s->ms.currentMacroAction.scrollMouse.y);
         s->as.actionActive = true;
     }
     return s->as.actionActive ? MacroResult_Blocking : MacroResult_Finished;
@@ -579,9 +725,12 @@ void Macros_ReportErrorNum(const char* err, int32_t num)
 
 static void clearScancodes()
 {
-    uint8_t oldMods = s->ms.macroBasicKeyboardReport.modifiers;
-    memset(&s->ms.macroBasicKeyboardReport, 0, sizeof s->ms.macroBasicKeyboardReport);
-    s->ms.macroBasicKeyboardReport.modifiers = oldMods;
+    clearOutputScancodes(s, KeystrokeType_Basic);
+}
+
+static bool basicScancodesFull()
+{
+    return UsbBasicKeyboardGetProtocol() == USB_HID_BOOT_PROTOCOL && outputScancodeCount(KeystrokeType_Basic) >= USB_BOOT_KEYBOARD_MAX_KEYS;
 }
 
 static macro_result_t dispatchText(const char* text, uint16_t textLen)
@@ -607,13 +756,13 @@ static macro_result_t dispatchText(const char* text, uint16_t textLen)
     // If required modifiers differ, first clear scancodes and send empty report
     // containing only old modifiers. Then set new modifiers and send that new report.
     // Just then continue.
-    if (mods != s->ms.macroBasicKeyboardReport.modifiers) {
+    if (mods != s->ms.outputModifierMask) {
         if (s->as.dispatchData.reportState != REPORT_EMPTY) {
             s->as.dispatchData.reportState = REPORT_EMPTY;
             clearScancodes();
             return MacroResult_Blocking;
         } else {
-            s->ms.macroBasicKeyboardReport.modifiers = mods;
+            s->ms.outputModifierMask = mods;
             return MacroResult_Blocking;
         }
     }
@@ -622,7 +771,8 @@ static macro_result_t dispatchText(const char* text, uint16_t textLen)
     if (s->as.dispatchData.textIdx == textLen) {
         s->as.dispatchData.textIdx = 0;
         s->as.dispatchData.reportState = REPORT_FULL;
-        memset(&s->ms.macroBasicKeyboardReport, 0, sizeof s->ms.macroBasicKeyboardReport);
+        clearScancodes();
+        s->ms.outputModifierMask = 0;
         dispatchMutex = NULL;
         return MacroResult_Finished;
     }
@@ -631,22 +781,22 @@ static macro_result_t dispatchText(const char* text, uint16_t textLen)
     if (s->as.dispatchData.reportState == REPORT_FULL) {
         s->as.dispatchData.reportState = REPORT_EMPTY;
 
-        memset(&s->ms.macroBasicKeyboardReport, 0, sizeof s->ms.macroBasicKeyboardReport);
+        clearScancodes();
+        s->ms.outputModifierMask = 0;
         return MacroResult_Blocking;
     }
 
     // If current character is already contained in the report, we need to
     // release it first. We do so by artificially marking the report
     // full. Next call will do rest of the work for us.
-    if (UsbBasicKeyboard_ContainsScancode(&s->ms.macroBasicKeyboardReport, scancode)) {
+    if (outputContainsScancode(scancode, KeystrokeType_Basic)) {
         s->as.dispatchData.reportState = REPORT_FULL;
         return MacroResult_Blocking;
     }
 
     // Send the scancode.
-    UsbBasicKeyboard_AddScancode(&s->ms.macroBasicKeyboardReport, scancode);
-    s->as.dispatchData.reportState = UsbBasicKeyboard_IsFullScancodes(&s->ms.macroBasicKeyboardReport) ?
-            REPORT_FULL : REPORT_PARTIAL;
+    addBasicScancode(scancode);
+    s->as.dispatchData.reportState = basicScancodesFull() ? REPORT_FULL : REPORT_PARTIAL;
     ++s->as.dispatchData.textIdx;
     return MacroResult_Blocking;
 }
@@ -918,6 +1068,7 @@ static macro_result_t stopAllMacrosCommand()
         if (&MacroState[i] != s) {
             MacroState[i].ms.macroBroken = true;
             MacroState[i].ms.macroSleeping = false;
+            cancelSleeperWaits(i);
         }
     }
     return MacroResult_Finished;
@@ -1190,7 +1341,7 @@ static macro_result_t processHoldLayer(uint8_t layer, uint8_t keymap, uint16_t t
             if (!s->ms.macroInterrupted) {
                 sleepTillTime(s->ms.currentMacroStartTime + timeout);
             }
-            sleepTillKeystateChange();
+            sleepTillKeyChange(s->ms.currentMacroKey);
             return MacroResult_Sleeping;
         }
         else {
@@ -1268,7 +1419,7 @@ static macro_result_t processDelayUntilReleaseMaxCommand(const char* arg1, const
     }
 
     if (currentMacroKeyIsActive() && Timer_GetElapsedTime(&s->ms.currentMacroStartTime) < timeout) {
-        sleepTillKeystateChange();
+        sleepTillKeyChange(s->ms.currentMacroKey);
         sleepTillTime(s->ms.currentMacroStartTime + timeout);
         return MacroResult_Sleeping;
     }
@@ -1278,7 +1429,7 @@ static macro_result_t processDelayUntilReleaseMaxCommand(const char* arg1, const
 static macro_result_t processDelayUntilReleaseCommand()
 {
     if (currentMacroKeyIsActive()) {
-        return sleepTillKeystateChange();
+        return sleepTillKeyChange(s->ms.currentMacroKey);
     }
     return MacroResult_Finished;
 }
@@ -1643,7 +1794,18 @@ static macro_result_t processPlayMacroCommand(const char* arg, const char *argEn
 {
     s->ms.reportsUsed = true;
     uint16_t id = parseRuntimeMacroSlotId(arg, argEnd);
-    bool res = MacroRecorder_PlayRuntimeMacroSmart(id, &s->ms.macroBasicKeyboardReport);
+
+    // The recorder plays into a full report, so round-trip the basic output through one.
+    usb_basic_keyboard_report_t report = { .modifiers = s->ms.outputModifierMask };
+    for (uint8_t entryIdx = s->ms.outputScancodes; entryIdx != 0; entryIdx = outputArena.scancodes[entryIdx - 1].next) {
+        if (outputArena.scancodes[entryIdx - 1].type == KeystrokeType_Basic) {
+            UsbBasicKeyboard_AddScancode(&report, outputArena.scancodes[entryIdx - 1].scancode);
+        }
+    }
+    bool res = MacroRecorder_PlayRuntimeMacroSmart(id, &report);
+    clearScancodes();
+    s->ms.outputModifierMask = report.modifiers;
+    UsbBasicKeyboard_ForeachScancode(&report, &addBasicScancode);
     return res ? MacroResult_Blocking : MacroResult_Finished;
 }
 
@@ -1971,8 +2133,7 @@ static macro_result_t processIfShortcutCommand(bool negate, const char* arg, con
                 if (timeoutIn != 0) {
                     sleepTillTime(referenceTime+timeoutIn);
                 }
-                sleepTillKeystateChange();
-                return MacroResult_Sleeping;
+                return sleepTillPostponedKeyEvent();
             }
             else if (cancelInTimedOut) {
                 PostponerExtended_ConsumePendingKeypresses(numArgs, true);
@@ -2075,7 +2236,7 @@ process_delay:;
         s->ms.autoRepeatPhase = AutoRepeatState_Executing;
         goto run_command;
     } else {
-        sleepTillKeystateChange();
+        sleepTillKeyChange(s->ms.currentMacroKey);
         return MacroResult_Sleeping;
     }
 
@@ -2963,6 +3124,7 @@ static uint8_t currentActionCmdCount() {
 static macro_result_t endMacro(void)
 {
     s->ms.macroSleeping = false;
+    cancelSleeperWaits(s - MacroState);
     s->ms.macroPlaying = false;
     s->ms.macroBroken = false;
     s->ps.previousMacroIndex = s->ms.currentMacroIndex;
@@ -3059,9 +3221,8 @@ static macro_result_t callMacro(uint8_t macroIndex)
 {
     unscheduleCurrentSlot();
     s->ms.macroSleeping = true;
-    s->ms.wakeMeOnKeystateChange = false;
-    s->ms.wakeMeOnTime = false;
     uint32_t slotIndex = s - MacroState;
+    cancelSleeperWaits(slotIndex);
     Macros_StartMacro(macroIndex, s->ms.currentMacroKey, slotIndex, true);
     return MacroResult_Finished | MacroResult_YieldFlag;
 }
@@ -3080,6 +3241,7 @@ uint8_t initMacro(uint8_t index, key_state_t *keyState, uint8_t parentMacroSlot)
 
     MacroPlaying = true;
 
+    releaseOutputScancodes(s);
     memset(&s->ms, 0, sizeof s->ms);
 
     s->ms.macroPlaying = true;
@@ -3176,46 +3338,192 @@ macro_result_t continueMacro(void)
     }
 }
 
-static macro_result_t sleepTillKeystateChange()
+static bool wakesEarlier(uint8_t slotA, uint8_t slotB)
 {
-    if (!s->ms.macroSleeping) {
-        unscheduleCurrentSlot();
+    return sleepers.wakeTimes[slotA] < sleepers.wakeTimes[slotB];
+}
+
+static void placeInTimerHeap(uint8_t slotIdx, uint8_t position)
+{
+    sleepers.timerHeap[position] = slotIdx;
+    sleepers.timerHeapPositions[slotIdx] = position;
+}
+
+static void siftTimerUp(uint8_t position)
+{
+    uint8_t slotIdx = sleepers.timerHeap[position];
+    while (position > 0) {
+        uint8_t parent = (position - 1) / 2;
+        if (!wakesEarlier(slotIdx, sleepers.timerHeap[parent])) {
+            break;
+        }
+        placeInTimerHeap(sleepers.timerHeap[parent], position);
+        position = parent;
+    }
+    placeInTimerHeap(slotIdx, position);
+}
+
+static void siftTimerDown(uint8_t position)
+{
+    uint8_t slotIdx = sleepers.timerHeap[position];
+    while (true) {
+        uint8_t child = 2*position + 1;
+        if (child >= sleepers.timerHeapSize) {
+            break;
+        }
+        if (child + 1 < sleepers.timerHeapSize && wakesEarlier(sleepers.timerHeap[child + 1], sleepers.timerHeap[child])) {
+            child++;
+        }
+        if (!wakesEarlier(sleepers.timerHeap[child], slotIdx)) {
+            break;
+        }
+        placeInTimerHeap(sleepers.timerHeap[child], position);
+        position = child;
+    }
+    placeInTimerHeap(slotIdx, position);
+}
+
+static void updateEarliestWakeTime()
+{
+    Macros_WakeMeOnTime = sleepers.timerHeapSize > 0 ? sleepers.wakeTimes[sleepers.timerHeap[0]] : 0xFFFFFFFF;
+}
+
+static void removeFromTimerHeap(uint8_t slotIdx)
+{
+    uint8_t position = sleepers.timerHeapPositions[slotIdx];
+    uint8_t lastSlotIdx = sleepers.timerHeap[--sleepers.timerHeapSize];
+    if (lastSlotIdx != slotIdx) {
+        placeInTimerHeap(lastSlotIdx, position);
+        siftTimerUp(position);
+        siftTimerDown(sleepers.timerHeapPositions[lastSlotIdx]);
+    }
+    updateEarliestWakeTime();
+}
+
+static uint8_t keyWaitListIdx(key_state_t *keyState)
+{
+    key_state_t *firstKeyState = &KeyStates[0][0];
+    if (keyState < firstKeyState || keyState >= firstKeyState + SLOT_COUNT*MAX_KEY_COUNT_PER_MODULE) {
+        return MACRO_KEY_WAIT_LIST_COUNT - 1;
+    }
+    return keyState - firstKeyState;
+}
+
+static void removeFromKeyWaitList(uint8_t slotIdx)
+{
+    uint8_t *link = &sleepers.keyWaitLists[sleepers.watchedKeys[slotIdx] - 1];
+    while (*link != slotIdx + 1) {
+        link = &sleepers.nextKeyWaiters[*link - 1];
+    }
+    *link = sleepers.nextKeyWaiters[slotIdx];
+    sleepers.nextKeyWaiters[slotIdx] = 0;
+    sleepers.watchedKeys[slotIdx] = 0;
+    sleepers.pendingKeyWakeups &= ~(1UL << slotIdx);
+    Macros_WakeMeOnKeystateChange = --sleepers.keyWaiterCount > 0;
+}
+
+static void cancelSleeperWaits(uint8_t slotIdx)
+{
+    if (MacroState[slotIdx].ms.wakeMeOnTime) {
+        removeFromTimerHeap(slotIdx);
     }
+    if (MacroState[slotIdx].ms.wakeMeOnKeystateChange) {
+        removeFromKeyWaitList(slotIdx);
+    }
+    sleepers.postponedEventWaiters &= ~(1UL << slotIdx);
+    Macros_WakeMeOnPostponedKeyEvent = sleepers.postponedEventWaiters != 0;
+    MacroState[slotIdx].ms.wakeMeOnTime = false;
+    MacroState[slotIdx].ms.wakeMeOnKeystateChange = false;
+}
+
+static void addToKeyWaitList(uint8_t slotIdx, uint8_t listIdx)
+{
+    if (MacroState[slotIdx].ms.wakeMeOnKeystateChange) {
+        if (sleepers.watchedKeys[slotIdx] == listIdx + 1) {
+            return;
+        }
+        // Watching two different keys means watching any key.
+        removeFromKeyWaitList(slotIdx);
+        listIdx = MACRO_KEY_WAIT_LIST_COUNT - 1;
+    }
+    sleepers.nextKeyWaiters[slotIdx] = sleepers.keyWaitLists[listIdx];
+    sleepers.keyWaitLists[listIdx] = slotIdx + 1;
+    sleepers.watchedKeys[slotIdx] = listIdx + 1;
+    sleepers.keyWaiterCount++;
     Macros_WakeMeOnKeystateChange = true;
-    s->ms.wakeMeOnKeystateChange = true;
-    s->ms.macroSleeping = true;
-    return MacroResult_Sleeping;
+    MacroState[slotIdx].ms.wakeMeOnKeystateChange = true;
 }
 
-static macro_result_t sleepTillTime(uint32_t time)
+static void putCurrentSlotToSleep()
 {
     if (!s->ms.macroSleeping) {
         unscheduleCurrentSlot();
     }
-    Macros_WakeMeOnTime = time < Macros_WakeMeOnTime ? time : Macros_WakeMeOnTime;
-    s->ms.wakeMeOnTime = true;
     s->ms.macroSleeping = true;
+}
+
+static macro_result_t sleepTillKeyChange(key_state_t *keyState)
+{
+    putCurrentSlotToSleep();
+    addToKeyWaitList(s - MacroState, keyWaitListIdx(keyState));
     return MacroResult_Sleeping;
 }
 
-static void wakeSleepers()
+// For commands that inspect the postponer queue: wakes on a change of the macro's own key and on
+// every key event that gets postponed, but not on the changes of other keys which bypass the queue.
+static macro_result_t sleepTillPostponedKeyEvent()
 {
-    if (Macros_WakedBecauseOfKeystateChange) {
-        Macros_WakedBecauseOfKeystateChange = false;
-        Macros_WakeMeOnKeystateChange = false;
-        for (uint8_t i = 0; i < MACRO_STATE_POOL_SIZE; i++) {
-            if (MacroState[i].ms.wakeMeOnKeystateChange) {
-                wakeMacroInSlot(i);
-            }
+    sleepTillKeyChange(s->ms.currentMacroKey);
+    sleepers.postponedEventWaiters |= 1UL << (s - MacroState);
+    Macros_WakeMeOnPostponedKeyEvent = true;
+    return MacroResult_Sleeping;
+}
+
+static macro_result_t sleepTillTime(uint32_t time)
+{
+    uint8_t slotIdx = s - MacroState;
+    putCurrentSlotToSleep();
+    if (!s->ms.wakeMeOnTime) {
+        sleepers.wakeTimes[slotIdx] = time;
+        placeInTimerHeap(slotIdx, sleepers.timerHeapSize++);
+        siftTimerUp(sleepers.timerHeapPositions[slotIdx]);
+        s->ms.wakeMeOnTime = true;
+    } else if (time < sleepers.wakeTimes[slotIdx]) {
+        sleepers.wakeTimes[slotIdx] = time;
+        siftTimerUp(sleepers.timerHeapPositions[slotIdx]);
+    }
+    updateEarliestWakeTime();
+    return MacroResult_Sleeping;
+}
+
+void Macros_WakeOnKeystateChange(key_state_t *keyState)
+{
+    uint8_t lists[] = { keyWaitListIdx(keyState), MACRO_KEY_WAIT_LIST_COUNT - 1 };
+    for (uint8_t i = 0; i < sizeof lists; i++) {
+        for (uint8_t waiter = sleepers.keyWaitLists[lists[i]]; waiter != 0; waiter = sleepers.nextKeyWaiters[waiter - 1]) {
+            sleepers.pendingKeyWakeups |= 1UL << (waiter - 1);
+            MacroPlaying = true;
         }
     }
+}
+
+void Macros_WakeOnPostponedKeyEvent(void)
+{
+    sleepers.pendingKeyWakeups |= sleepers.postponedEventWaiters;
+    MacroPlaying = true;
+}
+
+static void wakeSleepers()
+{
+    while (sleepers.pendingKeyWakeups) {
+        uint8_t slotIdx = __builtin_ctzl(sleepers.pendingKeyWakeups);
+        sleepers.pendingKeyWakeups &= ~(1UL << slotIdx);
+        wakeMacroInSlot(slotIdx);
+    }
     if (Macros_WakedBecauseOfTime) {
         Macros_WakedBecauseOfTime = false;
-        Macros_WakeMeOnTime = 0xFFFFFFFF;
-        for (uint8_t i = 0; i < MACRO_STATE_POOL_SIZE; i++) {
-            if (MacroState[i].ms.wakeMeOnTime) {
-                wakeMacroInSlot(i);
-            }
+        while (sleepers.timerHeapSize > 0 && sleepers.wakeTimes[sleepers.timerHeap[0]] < CurrentTime) {
+            wakeMacroInSlot(sleepers.timerHeap[0]);
         }
     }
 }
@@ -3239,10 +3547,9 @@ static void executePreemptive(void)
 
 static void wakeMacroInSlot(uint8_t slotIdx)
 {
+    cancelSleeperWaits(slotIdx);
     if (MacroState[slotIdx].ms.macroSleeping) {
         MacroState[slotIdx].ms.macroSleeping = false;
-        MacroState[slotIdx].ms.wakeMeOnTime = false;
-        MacroState[slotIdx].ms.wakeMeOnKeystateChange = false;
         scheduleSlot(slotIdx);
     }
 }
@@ -3372,3 +3679,26 @@ void Macros_ClearStatus(void)
 {
     processClearStatusCommand();
 }
+
+// Running macros keep their current action across a configuration update in
+// which the macros haven't changed, but its text points into the buffer of the
+// previous configuration, so it is moved to the same offset of the new one.
+void Macros_RebaseConfigPointers(const uint8_t *oldBuffer, const uint8_t *newBuffer)
+{
+    for (uint8_t i = 0; i < MACRO_STATE_POOL_SIZE; i++) {
+        macro_action_t *action = &MacroState[i].ms.currentMacroAction;
+        if (!MacroState[i].ms.macroPlaying) {
+            continue;
+        }
+        switch (action->type) {
+            case MacroActionType_Text:
+                action->text.text = (const char*)newBuffer + (action->text.text - (const char*)oldBuffer);
+                break;
+            case MacroActionType_Command:
+                action->cmd.text = (const char*)newBuffer + (action->cmd.text - (const char*)oldBuffer);
+                break;
+            default:
+                break;
+        }
+    }
+}
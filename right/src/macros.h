@@ -15,7 +15,12 @@
     #define MAX_MACRO_NUM 255
     #define STATUS_BUFFER_MAX_LENGTH 1024
     #define LAYER_STACK_SIZE 10
-    #define MACRO_STATE_POOL_SIZE 16
+    // Together with the output arena and the per-slot sleeper arrays, 20
+    // slots fit into the SRAM which 16 slots with embedded reports took.
+    #define MACRO_STATE_POOL_SIZE 20
+    #define MACRO_OUTPUT_ARENA_SIZE 64
+    // Per-key wait lists, plus one list of macros that wait for any key.
+    #define MACRO_KEY_WAIT_LIST_COUNT (SLOT_COUNT*MAX_KEY_COUNT_PER_MODULE + 1)
     #define MAX_REG_COUNT 32
 
     #define ALTMASK (HID_KEYBOARD_MODIFIER_LEFTALT | HID_KEYBOARD_MODIFIER_RIGHTALT)
@@ -152,10 +157,9 @@
             macro_autorepeat_state_t autoRepeatPhase: 1;
 
             uint8_t inputModifierMask;
-            usb_mouse_report_t macroMouseReport;
-            usb_basic_keyboard_report_t macroBasicKeyboardReport;
-            usb_media_keyboard_report_t macroMediaKeyboardReport;
-            usb_system_keyboard_report_t macroSystemKeyboardReport;
+            uint8_t outputModifierMask;
+            // Head of the list of output entries in the output arena, entryIdx+1.
+            uint8_t outputScancodes;
         } ms;
 
         // action scope data
@@ -200,6 +204,32 @@
         } as;
     }  macro_state_t;
 
+    // Mouse output is kept in the output arena too, as one entry per non-zero
+    // field, following the keystroke_type_t entries of scancodes.
+    typedef enum {
+        MacroOutputType_MouseButtons = KeystrokeType_System + 1,
+        MacroOutputType_MouseX,
+        MacroOutputType_MouseY,
+        MacroOutputType_WheelX,
+        MacroOutputType_WheelY,
+    } macro_output_type_t;
+
+    // Scancodes and mouse fields that macros currently hold are kept in a
+    // shared arena rather than in per-slot copies of all reports.
+    typedef struct {
+        // Scancode, or the value of the mouse field.
+        uint16_t scancode;
+        uint8_t type;
+        uint8_t next;
+    } macro_output_scancode_t;
+
+    typedef struct {
+        macro_output_scancode_t scancodes[MACRO_OUTPUT_ARENA_SIZE];
+        // Entries are linked by entryIdx+1, so that zero means end of list.
+        uint8_t freeList;
+        uint8_t untouchedIdx;
+    } macro_output_arena_t;
+
     // Schedule is given by a single-linked circular list.
     typedef struct {
         // Current slot is the next slot to be run. Previous reference is
@@ -219,9 +249,32 @@
         uint8_t remainingCount;
     } scheduler_state_t;
 
+    typedef struct {
+        // Binary min-heap of slots sleeping till a time, ordered by
+        // wakeTimes. Positions are stored so that a slot woken by a keystate
+        // change can be removed from the heap as well.
+        uint32_t wakeTimes[MACRO_STATE_POOL_SIZE];
+        uint8_t timerHeap[MACRO_STATE_POOL_SIZE];
+        uint8_t timerHeapPositions[MACRO_STATE_POOL_SIZE];
+        uint8_t timerHeapSize;
+        // Singly linked lists of slots sleeping till a keystate change, one
+        // per key. Links hold slotIdx+1 and watchedKeys hold listIdx+1, so
+        // that zero means empty/none.
+        uint8_t keyWaitLists[MACRO_KEY_WAIT_LIST_COUNT];
+        uint8_t nextKeyWaiters[MACRO_STATE_POOL_SIZE];
+        uint8_t watchedKeys[MACRO_STATE_POOL_SIZE];
+        uint8_t keyWaiterCount;
+        // Bitmask of slots whose watched key has changed since the last wake.
+        uint32_t pendingKeyWakeups;
+        // Bitmask of slots which also wake on any key event entering the
+        // postponer queue.
+        uint32_t postponedEventWaiters;
+    } sleeper_state_t;
+
 // Variables:
 
-    extern macro_reference_t AllMacros[MAX_MACRO_NUM];
+    extern macro_reference_t *AllMacros;
+    extern macro_reference_t *StagingMacros;
     extern uint8_t AllMacrosCount;
     extern macro_state_t MacroState[MACRO_STATE_POOL_SIZE];
     extern bool MacroPlaying;
@@ -232,8 +285,8 @@
     extern uint8_t Macros_MaxBatchSize;
     extern uint32_t Macros_WakeMeOnTime;
     extern bool Macros_WakeMeOnKeystateChange;
+    extern bool Macros_WakeMeOnPostponedKeyEvent;
     extern bool Macros_WakedBecauseOfTime;
-    extern bool Macros_WakedBecauseOfKeystateChange;
     extern uint16_t DoubletapConditionTimeout;
     extern uint16_t AutoRepeatInitialDelay;
     extern uint16_t AutoRepeatDelayRate;
@@ -259,15 +312,22 @@
     void Macros_ResetLayerStack();
     void Macros_Initialize();
     void Macros_ClearStatus();
+    void Macros_RebaseConfigPointers(const uint8_t *oldBuffer, const uint8_t *newBuffer);
     bool Macros_IsLayerHeld();
     uint8_t Macros_ParseLayerId(const char* arg1, const char* cmdEnd);
     int32_t Macros_ParseInt(const char *a, const char *aEnd, const char* *parsedTill);
     bool Macros_ParseBoolean(const char *a, const char *aEnd);
+    void Macros_WakeOnKeystateChange(key_state_t *keyState);
+    void Macros_WakeOnPostponedKeyEvent(void);
+    void Macros_MergeOutput(uint8_t slotIdx);
+
+#define WAKE_MACROS_ON_KEYSTATE_CHANGE(KEYSTATE)  if (Macros_WakeMeOnKeystateChange) { \
+                                                      Macros_WakeOnKeystateChange(KEYSTATE); \
+                                                  }
 
-#define WAKE_MACROS_ON_KEYSTATE_CHANGE()  if (Macros_WakeMeOnKeystateChange) { \
-                                              Macros_WakedBecauseOfKeystateChange = true; \
-                                              MacroPlaying = true; \
-                                          }
+#define WAKE_MACROS_ON_POSTPONED_KEY_EVENT()      if (Macros_WakeMeOnPostponedKeyEvent) { \
+                                                      Macros_WakeOnPostponedKeyEvent(); \
+                                                  }
 
 
 #endif
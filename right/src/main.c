@@ -14,21 +14,25 @@
 #include "macro_events.h"
 #include "macro_shortcut_parser.h"
 #include "ledmap.h"
+#include "boot_phases.h"
 
 static bool IsEepromInitialized = false;
 static bool IsConfigInitialized = false;
 
 static void userConfigurationReadFinished(void)
 {
+    BootPhases_Mark(BootPhase_UserConfigRead);
     IsEepromInitialized = true;
 }
 
 static void hardwareConfigurationReadFinished(void)
 {
+    BootPhases_Mark(BootPhase_HardwareConfigRead);
     InitLedLayout();
     if (IsFactoryResetModeEnabled) {
         HardwareConfig->signatureLength = HARDWARE_CONFIG_SIGNATURE_LENGTH;
         strncpy(HardwareConfig->signature, "FTY", HARDWARE_CONFIG_SIGNATURE_LENGTH);
+        ConfigBuffer_MarkChanged(HardwareConfigBuffer.buffer, 0, HARDWARE_CONFIG_SIZE);
     }
     EEPROM_LaunchTransfer(EepromOperation_Read, ConfigBufferId_StagingUserConfig, userConfigurationReadFinished);
 }
@@ -53,8 +57,10 @@ int main(void)
         while (1) {
             if (!IsConfigInitialized && IsEepromInitialized) {
                 UsbCommand_ApplyConfig();
+                BootPhases_Mark(BootPhase_ConfigApplied);
                 ShortcutParser_initialize();
                 Macros_Initialize();
+                BootPhases_Mark(BootPhase_MacrosInitialized);
                 IsConfigInitialized = true;
             }
             KeyMatrix_ScanRow(&RightKeyMatrix);
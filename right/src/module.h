@@ -11,6 +11,12 @@
 
     #define MAX_KEY_COUNT_PER_MODULE     35
 
+    // Speed -> multiplier table of the acceleration curve, sampled at
+    // MODULE_SPEED_TABLE_RESOLUTION points per px/ms. Speeds beyond the last
+    // point are computed directly.
+    #define MODULE_SPEED_TABLE_SIZE       33
+    #define MODULE_SPEED_TABLE_RESOLUTION 4.0f
+
 // Typedefs:
 
     typedef enum {
@@ -33,7 +39,10 @@
 
     typedef struct {
         // working 'cache'
-        float currentSpeed; // px/ms
+        float currentSpeed; // px/ms, exponential moving average
+        uint32_t lastSpeedUpdate;
+        bool speedTableValid;
+        float speedTable[MODULE_SPEED_TABLE_SIZE];
 
         // acceleration configurations
         float baseSpeed;
@@ -21,6 +21,7 @@
 #include "macros.h"
 #include "debug.h"
 #include "postponer.h"
+#include "pointer_source.h"
 #include "layer.h"
 #include "secondary_role_driver.h"
 
@@ -32,6 +33,13 @@ uint8_t ToggledMouseStates[ACTIVE_MOUSE_STATES_COUNT];
 
 bool DiagonalSpeedCompensation = false;
 
+mouse_motion_t PendingMouseMotion;
+
+static pointer_source_reader_t modulePointerReaders[UHK_MODULE_MAX_SLOT_COUNT];
+static pointer_source_reader_t touchpadCursorReader;
+static pointer_source_reader_t touchpadWheelReader;
+static pointer_source_reader_t touchpadZoomReader;
+
 mouse_kinetic_state_t MouseMoveState = {
     .isScroll = false,
     .upState = SerializedMouseAction_MoveUp,
@@ -206,8 +214,12 @@ static void processMouseKineticState(mouse_kinetic_state_t *kineticState)
             distance /= 1.41f;
         }
 
-        kineticState->xSum += distance * kineticState->horizontalStateSign * kineticState->axisSkew;
-        kineticState->ySum += distance * kineticState->verticalStateSign / kineticState->axisSkew;
+        // Scroll is measured in wheel detents, which the host may want to receive in finer units
+        float xResolution = kineticState->isScroll ? UsbMouseGetHorizontalWheelMultiplier() : 1;
+        float yResolution = kineticState->isScroll ? UsbMouseGetVerticalWheelMultiplier() : 1;
+
+        kineticState->xSum += distance * kineticState->horizontalStateSign * kineticState->axisSkew * xResolution;
+        kineticState->ySum += distance * kineticState->verticalStateSign / kineticState->axisSkew * yResolution;
 
         // Update horizontal state
 
@@ -220,7 +232,7 @@ static void processMouseKineticState(mouse_kinetic_state_t *kineticState)
 
         // Handle the first scroll tick.
         if (kineticState->isScroll && !kineticState->wasMoveAction && kineticState->xOut == 0 && horizontalMovement) {
-            kineticState->xOut = ActiveMouseStates[kineticState->leftState] ? -1 : 1;
+            kineticState->xOut = ActiveMouseStates[kineticState->leftState] ? -xResolution : xResolution;
             kineticState->xSum = 0;
         }
 
@@ -235,7 +247,7 @@ static void processMouseKineticState(mouse_kinetic_state_t *kineticState)
 
         // Handle the first scroll tick.
         if (kineticState->isScroll && !kineticState->wasMoveAction && kineticState->yOut == 0 && verticalMovement) {
-            kineticState->yOut = ActiveMouseStates[kineticState->upState] ? -1 : 1;
+            kineticState->yOut = ActiveMouseStates[kineticState->upState] ? -yResolution : yResolution;
             kineticState->ySum = 0;
         }
     } else {
@@ -246,41 +258,59 @@ static void processMouseKineticState(mouse_kinetic_state_t *kineticState)
     kineticState->wasMoveAction = isMoveAction;
 }
 
-static float fastPow (float a, float b)
+//means that driver multiplier equals 1.0 at average speed midSpeed px/ms
+#define MODULE_MID_SPEED 3.0f
+
+// weight of the newest sample in the speed estimate
+#define MODULE_SPEED_SMOOTHING 0.5f
+
+// samples further apart than this are not averaged with the previous estimate
+#define MODULE_SPEED_IDLE_TIMEOUT 100
+
+static float computeModuleSpeedMultiplier(module_configuration_t *moduleConfiguration, float speed)
 {
-    // https://nic.schraudolph.org/pubs/Schraudolph99.pdf
-    // https://martin.ankerl.com/2007/10/04/optimized-pow-approximation-for-java-and-c-c/
-    if ( b == 0.0f ) {
-        return 1.0f;
-    } else {
-        union {
-            float f;
-            int16_t x[2];
-        } u = { a } ;
+    float normalizedSpeed = speed/MODULE_MID_SPEED;
+    return moduleConfiguration->baseSpeed + moduleConfiguration->speed*powf(normalizedSpeed, moduleConfiguration->xceleration);
+}
 
-        u.x[1] = (int16_t)(b * (u.x[1] - 16249) + 16249);
-        u.x[0] = 0;
-        return u.f;
+static void updateModuleSpeedTable(module_configuration_t *moduleConfiguration)
+{
+    for (uint8_t i = 0; i < MODULE_SPEED_TABLE_SIZE; i++) {
+        moduleConfiguration->speedTable[i] = computeModuleSpeedMultiplier(moduleConfiguration, i / MODULE_SPEED_TABLE_RESOLUTION);
     }
+    moduleConfiguration->speedTableValid = true;
 }
 
-static float computeModuleSpeed(float x, float y, uint8_t moduleId)
+static float computeModuleSpeed(float x, float y, uint32_t timestamp, uint8_t moduleId)
 {
-    //means that driver multiplier equals 1.0 at average speed midSpeed px/ms
-    static float midSpeed = 3.0f;
     module_configuration_t *moduleConfiguration = GetModuleConfiguration(moduleId);
     float *currentSpeed = &moduleConfiguration->currentSpeed;
 
     if (x != 0 || y != 0) {
-        static uint32_t lastUpdate = 0;
-        uint32_t elapsedTime = CurrentTime - lastUpdate;
-        float distance = sqrt(x*x + y*y);
-        *currentSpeed = distance / (elapsedTime + 1);
-        lastUpdate = CurrentTime;
+        uint32_t elapsedTime = timestamp - moduleConfiguration->lastSpeedUpdate;
+        float distance = sqrtf(x*x + y*y);
+        float sampleSpeed = distance / (elapsedTime + 1);
+        if (elapsedTime > MODULE_SPEED_IDLE_TIMEOUT) {
+            *currentSpeed = sampleSpeed;
+        } else {
+            *currentSpeed += MODULE_SPEED_SMOOTHING * (sampleSpeed - *currentSpeed);
+        }
+        moduleConfiguration->lastSpeedUpdate = timestamp;
+    }
+
+    if (!moduleConfiguration->speedTableValid) {
+        updateModuleSpeedTable(moduleConfiguration);
+    }
+
+    float position = *currentSpeed * MODULE_SPEED_TABLE_RESOLUTION;
+    if (position >= MODULE_SPEED_TABLE_SIZE - 1) {
+        return computeModuleSpeedMultiplier(moduleConfiguration, *currentSpeed);
     }
 
-    float normalizedSpeed = *currentSpeed/midSpeed;
-    return moduleConfiguration->baseSpeed + moduleConfiguration->speed*fastPow(normalizedSpeed, moduleConfiguration->xceleration);
+    uint8_t index = (uint8_t)position;
+    float fraction = position - index;
+    float *speedTable = moduleConfiguration->speedTable;
+    return speedTable[index] + fraction*(speedTable[index+1] - speedTable[index]);
 }
 
 
@@ -440,13 +470,13 @@ static void progressZoomAction(module_kinetic_state_t* ks) {
 static void handleNewCaretModeAction(caret_axis_t axis, uint8_t resultSign, int16_t value, module_kinetic_state_t* ks) {
     switch(ks->currentNavigationMode) {
         case NavigationMode_Cursor: {
-            ActiveUsbMouseReport->x += axis == CaretAxis_Horizontal ? value : 0;
-            ActiveUsbMouseReport->y -= axis == CaretAxis_Vertical ? value : 0;
+            PendingMouseMotion.x += axis == CaretAxis_Horizontal ? value : 0;
+            PendingMouseMotion.y -= axis == CaretAxis_Vertical ? value : 0;
             break;
         }
         case NavigationMode_Scroll: {
-            ActiveUsbMouseReport->wheelX += axis == CaretAxis_Horizontal ? value : 0;
-            ActiveUsbMouseReport->wheelY += axis == CaretAxis_Vertical ? value : 0;
+            PendingMouseMotion.wheelX += axis == CaretAxis_Horizontal ? value : 0;
+            PendingMouseMotion.wheelY += axis == CaretAxis_Vertical ? value : 0;
             break;
         }
         case NavigationMode_ZoomMac:
@@ -608,6 +638,7 @@ static void processAxisLocking(
 static void processModuleKineticState(
         float x,
         float y,
+        uint32_t timestamp,
         module_configuration_t* moduleConfiguration,
         module_kinetic_state_t* ks,
         uint8_t forcedNavigationMode
@@ -618,7 +649,7 @@ static void processModuleKineticState(
     bool scrollYInversion = moduleConfiguration->invertScrollDirection && ks->currentNavigationMode == NavigationMode_Scroll;
     int16_t yInversion = moduleYInversion != scrollYInversion ? -1 : 1;
 
-    speed = computeModuleSpeed(x, y, ks->currentModuleId);
+    speed = computeModuleSpeed(x, y, timestamp, ks->currentModuleId);
 
     if (ActiveMouseStates[SerializedMouseAction_Accelerate] ) {
         speed *= 2.0f;
@@ -636,14 +667,18 @@ static void processModuleKineticState(
                 ks->xFractionRemainder = modff(ks->xFractionRemainder + x * speed, &xIntegerPart);
                 ks->yFractionRemainder = modff(ks->yFractionRemainder + y * speed, &yIntegerPart);
 
-                ActiveUsbMouseReport->x += xIntegerPart;
-                ActiveUsbMouseReport->y -= yInversion*yIntegerPart;
+                PendingMouseMotion.x += xIntegerPart;
+                PendingMouseMotion.y -= yInversion*yIntegerPart;
             } else {
                 processAxisLocking(x, y, speed, yInversion, 1.0f, true, moduleConfiguration->axisLockSkew, moduleConfiguration->axisLockFirstTickSkew, ks, true);
             }
             break;
         }
         case NavigationMode_Scroll:  {
+            // express the motion in high-resolution wheel units if the host has negotiated them
+            x *= UsbMouseGetHorizontalWheelMultiplier();
+            y *= UsbMouseGetVerticalWheelMultiplier();
+
             if (!moduleConfiguration->scrollAxisLock) {
                 float xIntegerPart;
                 float yIntegerPart;
@@ -651,8 +686,8 @@ static void processModuleKineticState(
                 ks->xFractionRemainder = modff(ks->xFractionRemainder + x * speed / moduleConfiguration->scrollSpeedDivisor, &xIntegerPart);
                 ks->yFractionRemainder = modff(ks->yFractionRemainder + y * speed / moduleConfiguration->scrollSpeedDivisor, &yIntegerPart);
 
-                ActiveUsbMouseReport->wheelX += xIntegerPart;
-                ActiveUsbMouseReport->wheelY += yInversion*yIntegerPart;
+                PendingMouseMotion.wheelX += xIntegerPart;
+                PendingMouseMotion.wheelY += yInversion*yIntegerPart;
             } else {
                 processAxisLocking(x, y, speed, yInversion, moduleConfiguration->scrollSpeedDivisor, true, moduleConfiguration->axisLockSkew, moduleConfiguration->axisLockFirstTickSkew, ks, true);
             }
@@ -703,6 +738,7 @@ static void processModuleActions(
         uint8_t moduleId,
         float x,
         float y,
+        uint32_t timestamp,
         uint8_t forcedNavigationMode
 ) {
     module_configuration_t *moduleConfiguration = GetModuleConfiguration(moduleId);
@@ -746,7 +782,7 @@ static void processModuleActions(
     //we want to process kinetic state even if x == 0 && y == 0, at least as
     //long as caretAxis != CaretAxis_None because of fake key states that may
     //be active.
-    processModuleKineticState(x, y, moduleConfiguration, ks, forcedNavigationMode);
+    processModuleKineticState(x, y, timestamp, moduleConfiguration, ks, forcedNavigationMode);
 }
 
 void MouseController_ProcessMouseActions()
@@ -754,20 +790,19 @@ void MouseController_ProcessMouseActions()
     mouseElapsedTime = Timer_GetElapsedTimeAndSetCurrent(&mouseUsbReportUpdateTime);
 
     processMouseKineticState(&MouseMoveState);
-    ActiveUsbMouseReport->x = MouseMoveState.xOut;
-    ActiveUsbMouseReport->y = MouseMoveState.yOut;
+    PendingMouseMotion.x += MouseMoveState.xOut;
+    PendingMouseMotion.y += MouseMoveState.yOut;
     MouseMoveState.xOut = 0;
     MouseMoveState.yOut = 0;
 
     processMouseKineticState(&MouseScrollState);
-    ActiveUsbMouseReport->wheelX = MouseScrollState.xOut;
-    ActiveUsbMouseReport->wheelY = MouseScrollState.yOut;
+    PendingMouseMotion.wheelX += MouseScrollState.xOut;
+    PendingMouseMotion.wheelY += MouseScrollState.yOut;
     MouseScrollState.xOut = 0;
     MouseScrollState.yOut = 0;
 
 
     if (Slaves[SlaveId_RightTouchpad].isConnected) {
-        // TODO: this is still unsafe w.r.t interrupts
         processTouchpadActions();
 
         module_kinetic_state_t *ks = getKineticState(ModuleId_TouchpadRight);
@@ -776,14 +811,14 @@ void MouseController_ProcessMouseActions()
             handleRunningCaretModeAction(ks);
         }
 
-        processModuleActions(ks, ModuleId_TouchpadRight, (int16_t)TouchpadEvents.x, (int16_t)TouchpadEvents.y, 0xFF);
-        processModuleActions(ks, ModuleId_TouchpadRight, (int16_t)TouchpadEvents.wheelX, (int16_t)TouchpadEvents.wheelY, NavigationMode_Scroll);
-        processModuleActions(ks, ModuleId_TouchpadRight, 0, (int16_t)TouchpadEvents.zoomLevel, NavigationMode_Zoom);
-        TouchpadEvents.zoomLevel = 0;
-        TouchpadEvents.wheelX = 0;
-        TouchpadEvents.wheelY = 0;
-        TouchpadEvents.x = 0;
-        TouchpadEvents.y = 0;
+        pointer_sample_t cursor, wheel, zoom;
+        PointerSource_Read(&TouchpadEvents.cursor, &touchpadCursorReader, &cursor);
+        PointerSource_Read(&TouchpadEvents.wheel, &touchpadWheelReader, &wheel);
+        PointerSource_Read(&TouchpadEvents.zoom, &touchpadZoomReader, &zoom);
+
+        processModuleActions(ks, ModuleId_TouchpadRight, cursor.x, cursor.y, cursor.timestamp, 0xFF);
+        processModuleActions(ks, ModuleId_TouchpadRight, wheel.x, wheel.y, wheel.timestamp, NavigationMode_Scroll);
+        processModuleActions(ks, ModuleId_TouchpadRight, 0, zoom.y, zoom.timestamp, NavigationMode_Zoom);
     }
 
     for (uint8_t moduleSlotId=0; moduleSlotId<UHK_MODULE_MAX_SLOT_COUNT; moduleSlotId++) {
@@ -792,15 +827,8 @@ void MouseController_ProcessMouseActions()
             continue;
         }
 
-        __disable_irq();
-        // Gcc compiles those int16_t assignments as sequences of
-        // single-byte instructions, therefore we need to make the
-        // sequence atomic.
-        int16_t x = moduleState->pointerDelta.x;
-        int16_t y = moduleState->pointerDelta.y;
-        moduleState->pointerDelta.x = 0;
-        moduleState->pointerDelta.y = 0;
-        __enable_irq();
+        pointer_sample_t sample;
+        PointerSource_Read(&moduleState->pointerSource, modulePointerReaders + moduleSlotId, &sample);
 
         module_kinetic_state_t *ks = getKineticState(moduleState->moduleId);
 
@@ -808,7 +836,7 @@ void MouseController_ProcessMouseActions()
             handleRunningCaretModeAction(ks);
         }
 
-        processModuleActions(ks, moduleState->moduleId, x, y, 0xFF);
+        processModuleActions(ks, moduleState->moduleId, sample.x, sample.y, sample.timestamp, 0xFF);
     }
 
     if (ActiveMouseStates[SerializedMouseAction_LeftClick]) {
@@ -837,6 +865,41 @@ void MouseController_ProcessMouseActions()
     }
 }
 
+static int32_t saturate(int32_t value, int32_t limit)
+{
+    return value > limit ? limit : value < -limit ? -limit : value;
+}
+
+// Motion which doesn't fit into one report stays pending, but only up to a
+// few reports worth, so that a host which stops polling for a while doesn't
+// get a huge jump afterwards.
+static void capPendingMotion(void)
+{
+    int32_t maxAxisValue = MOUSE_MOTION_MAX_PENDING_REPORTS * USB_MOUSE_MAX_AXIS_VALUE;
+    int32_t maxWheelValue = MOUSE_MOTION_MAX_PENDING_REPORTS * USB_MOUSE_MAX_WHEEL_VALUE;
+    PendingMouseMotion.x = saturate(PendingMouseMotion.x, maxAxisValue);
+    PendingMouseMotion.y = saturate(PendingMouseMotion.y, maxAxisValue);
+    PendingMouseMotion.wheelX = saturate(PendingMouseMotion.wheelX, maxWheelValue);
+    PendingMouseMotion.wheelY = saturate(PendingMouseMotion.wheelY, maxWheelValue);
+}
+
+void MouseController_FillReportMotion(usb_mouse_report_t *report)
+{
+    capPendingMotion();
+    report->x = saturate(PendingMouseMotion.x, USB_MOUSE_MAX_AXIS_VALUE);
+    report->y = saturate(PendingMouseMotion.y, USB_MOUSE_MAX_AXIS_VALUE);
+    report->wheelX = saturate(PendingMouseMotion.wheelX, USB_MOUSE_MAX_WHEEL_VALUE);
+    report->wheelY = saturate(PendingMouseMotion.wheelY, USB_MOUSE_MAX_WHEEL_VALUE);
+}
+
+void MouseController_ConsumeReportMotion(const usb_mouse_report_t *report)
+{
+    PendingMouseMotion.x -= report->x;
+    PendingMouseMotion.y -= report->y;
+    PendingMouseMotion.wheelX -= report->wheelX;
+    PendingMouseMotion.wheelY -= report->wheelY;
+}
+
 void ToggleMouseState(serialized_mouse_action_t action, bool activate)
 {
     if (activate) {
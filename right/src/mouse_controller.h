@@ -5,11 +5,13 @@
     #include "caret_config.h"
     #include "key_action.h"
     #include "key_states.h"
+    #include "usb_interfaces/usb_interface_mouse.h"
 
 // Macros:
 
     #define ACTIVE_MOUSE_STATES_COUNT (SerializedMouseAction_Last + 1)
     #define ABS(A) ((A) < 0 ? (-A) : (A))
+    #define MOUSE_MOTION_MAX_PENDING_REPORTS 4
 
 // Typedefs:
 
@@ -44,6 +46,14 @@
         int8_t horizontalStateSign;
     } mouse_kinetic_state_t;
 
+    // Motion produced by all pointer sources which hasn't been sent to the host yet.
+    typedef struct {
+        int32_t x;
+        int32_t y;
+        int32_t wheelX;
+        int32_t wheelY;
+    } mouse_motion_t;
+
     typedef struct {
         key_action_cached_t caretAction;
         key_state_t caretFakeKeystate;
@@ -68,9 +78,12 @@
     extern uint8_t ToggledMouseStates[ACTIVE_MOUSE_STATES_COUNT];
 
     extern bool DiagonalSpeedCompensation;
+    extern mouse_motion_t PendingMouseMotion;
 
 // Functions:
     void MouseController_ActivateDirectionSigns(uint8_t state);
     void MouseController_ProcessMouseActions();
+    void MouseController_FillReportMotion(usb_mouse_report_t *report);
+    void MouseController_ConsumeReportMotion(const usb_mouse_report_t *report);
 
 #endif
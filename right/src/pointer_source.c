@@ -0,0 +1,35 @@
+#include "pointer_source.h"
+#include "timer.h"
+
+void PointerSource_Push(pointer_source_t *source, int16_t x, int16_t y)
+{
+    source->sequence++;
+    source->x += (int32_t)x;
+    source->y += (int32_t)y;
+    source->timestamp = CurrentTime;
+    source->sequence++;
+}
+
+// Returns the motion accumulated since the previous read of the same reader.
+bool PointerSource_Read(const pointer_source_t *source, pointer_source_reader_t *reader, pointer_sample_t *sample)
+{
+    uint32_t sequence;
+    uint32_t x;
+    uint32_t y;
+    uint32_t timestamp;
+
+    do {
+        sequence = source->sequence;
+        x = source->x;
+        y = source->y;
+        timestamp = source->timestamp;
+    } while ((sequence & 1) || sequence != source->sequence);
+
+    sample->x = (int32_t)(x - reader->x);
+    sample->y = (int32_t)(y - reader->y);
+    sample->timestamp = timestamp;
+    reader->x = x;
+    reader->y = y;
+
+    return sample->x != 0 || sample->y != 0;
+}
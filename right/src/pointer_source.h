@@ -0,0 +1,42 @@
+#ifndef __POINTER_SOURCE_H__
+#define __POINTER_SOURCE_H__
+
+// Includes:
+
+    #include <stdint.h>
+    #include <stdbool.h>
+
+// Typedefs:
+
+    // Written by a single producer (a slave driver running in the I2C
+    // interrupt) and read by a single consumer (the mouse controller).
+    //
+    // The producer only ever adds to the running sums, and the consumer keeps
+    // its own copy of the sums it has already processed, so neither side has
+    // to reset the other's data. The sequence counter is odd while an update
+    // is in progress, which lets the consumer detect and retry torn reads
+    // without masking interrupts.
+    typedef struct {
+        volatile uint32_t sequence;
+        volatile uint32_t x; // running sums, allowed to wrap around
+        volatile uint32_t y;
+        volatile uint32_t timestamp;
+    } pointer_source_t;
+
+    typedef struct {
+        uint32_t x;
+        uint32_t y;
+    } pointer_source_reader_t;
+
+    typedef struct {
+        int32_t x;
+        int32_t y;
+        uint32_t timestamp; // CurrentTime of the most recent delta
+    } pointer_sample_t;
+
+// Functions:
+
+    void PointerSource_Push(pointer_source_t *source, int16_t x, int16_t y);
+    bool PointerSource_Read(const pointer_source_t *source, pointer_source_reader_t *reader, pointer_sample_t *sample);
+
+#endif
@@ -6,6 +6,7 @@
 #include "layer_switcher.h"
 #include "keymap.h"
 #include "key_action.h"
+#include "combos.h"
 
 postponer_buffer_record_type_t buffer[POSTPONER_BUFFER_SIZE];
 uint8_t bufferSize = 0;
@@ -89,6 +90,13 @@ bool PostponerCore_IsActive(void)
 
 
 void PostponerCore_TrackKeyEvent(key_state_t *keyState, bool active, uint8_t layer)
+{
+    PostponerCore_TrackKeyEventAt(keyState, active, layer, CurrentTime);
+}
+
+// Events of modules may arrive later than events which happened after them, so they are
+// inserted in the order of their timestamps.
+void PostponerCore_TrackKeyEventAt(key_state_t *keyState, bool active, uint8_t layer, uint32_t time)
 {
     uint8_t pos = POS(bufferSize);
 
@@ -98,14 +106,28 @@ void PostponerCore_TrackKeyEvent(key_state_t *keyState, bool active, uint8_t lay
         consumeEvent(1);
     }
 
-    buffer[pos] = (postponer_buffer_record_type_t) {
-            .time = CurrentTime,
+    uint8_t idx = bufferSize;
+    while (idx > 0 && (int32_t)(buffer[POS(idx-1)].time - time) > 0) {
+        buffer[POS(idx)] = buffer[POS(idx-1)];
+        idx--;
+    }
+    bool isInserted = idx < bufferSize;
+
+    buffer[POS(idx)] = (postponer_buffer_record_type_t) {
+            .time = time,
             .key = keyState,
             .active = active,
             .layer = layer,
     };
     bufferSize = bufferSize < POSTPONER_BUFFER_SIZE ? bufferSize + 1 : bufferSize;
-    lastPressTime = active ? CurrentTime : lastPressTime;
+    if (isInserted) {
+        Postponer_NextEventKey = buffer[bufferPosition].key;
+        Combos_ResetAutomaton();
+    }
+    if (active && (int32_t)(time - lastPressTime) > 0) {
+        lastPressTime = time;
+    }
+    WAKE_MACROS_ON_POSTPONED_KEY_EVENT();
 }
 
 void PostponerCore_RunPostponedEvents(void)
@@ -113,15 +135,19 @@ void PostponerCore_RunPostponedEvents(void)
     if (ChordingDelay) {
         chording();
     }
+    if (ComboCount) {
+        Combos_RunPostponedEvents();
+    }
     // Process one event every two cycles. (Unless someone keeps Postponer active by touching cycles_until_activation.)
     if (bufferSize != 0 && (cyclesUntilActivation == 0 || bufferSize > POSTPONER_BUFFER_MAX_FILL)) {
-        buffer[bufferPosition].key->current = buffer[bufferPosition].active;
+        key_state_t *keyState = buffer[bufferPosition].key;
+        keyState->current = buffer[bufferPosition].active;
         Postponer_LastKeyLayer = buffer[bufferPosition].layer;
         consumeEvent(1);
         // This gives the key two ticks (this and next) to get properly processed before execution of next queued event.
         PostponerCore_PostponeNCycles(1);
         // wake macros
-        WAKE_MACROS_ON_KEYSTATE_CHANGE();
+        WAKE_MACROS_ON_KEYSTATE_CHANGE(keyState);
     }
 }
 
@@ -135,6 +161,11 @@ void PostponerCore_FinishCycle(void)
 //#######################
 
 
+uint8_t PostponerQuery_PendingEventCount(void)
+{
+    return bufferSize;
+}
+
 uint8_t PostponerQuery_PendingKeypressCount()
 {
     uint8_t cnt = 0;
@@ -210,6 +241,11 @@ uint16_t PostponerExtended_PendingId(uint16_t idx)
     return Utils_KeyStateToKeyId(getPendingKeypress(idx));
 }
 
+postponer_buffer_record_type_t* PostponerExtended_PendingEvent(uint8_t idx)
+{
+    return idx < bufferSize ? &buffer[POS(idx)] : NULL;
+}
+
 uint32_t PostponerExtended_LastPressTime()
 {
     return lastPressTime;
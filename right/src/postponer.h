@@ -50,17 +50,20 @@
     void PostponerCore_PostponeNCycles(uint8_t n);
     bool PostponerCore_RunKey(key_state_t* key, bool active);
     void PostponerCore_TrackKeyEvent(key_state_t *keyState, bool active, uint8_t layer);
+    void PostponerCore_TrackKeyEventAt(key_state_t *keyState, bool active, uint8_t layer, uint32_t time);
     void PostponerCore_RunPostponedEvents(void);
     void PostponerCore_FinishCycle(void);
 
 // Functions (Basic Query APIs):
 
+    uint8_t PostponerQuery_PendingEventCount(void);
     uint8_t PostponerQuery_PendingKeypressCount();
     bool PostponerQuery_IsKeyReleased(key_state_t* key);
     bool PostponerQuery_IsActiveEventually(key_state_t* key);
 
 // Functions (Query APIs extended):
     uint16_t PostponerExtended_PendingId(uint16_t idx);
+    postponer_buffer_record_type_t* PostponerExtended_PendingEvent(uint8_t idx);
     uint32_t PostponerExtended_LastPressTime(void);
     bool PostponerExtended_IsPendingKeyReleased(uint8_t idx);
     bool PostponerQuery_ContainsKeyId(uint8_t keyid);
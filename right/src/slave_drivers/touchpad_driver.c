@@ -161,14 +161,14 @@ slave_result_t TouchpadDriver_Update(uint8_t uhkModuleDriverId)
             TouchpadEvents.tapAndHold = gestureEvents.events0.tapAndHold;
             TouchpadEvents.noFingers = noFingers;
 
-            if (gestureEvents.events1.scroll) {
-                TouchpadEvents.wheelX -= deltaX;
-                TouchpadEvents.wheelY += deltaY;
-            } else if (gestureEvents.events1.zoom) {
-                TouchpadEvents.zoomLevel -= deltaY;
-            } else {
-                TouchpadEvents.x -= deltaX;
-                TouchpadEvents.y += deltaY;
+            if (deltaX != 0 || deltaY != 0) {
+                if (gestureEvents.events1.scroll) {
+                    PointerSource_Push(&TouchpadEvents.wheel, -deltaX, deltaY);
+                } else if (gestureEvents.events1.zoom) {
+                    PointerSource_Push(&TouchpadEvents.zoom, 0, -deltaY);
+                } else {
+                    PointerSource_Push(&TouchpadEvents.cursor, -deltaX, deltaY);
+                }
             }
 
             res.status = I2cAsyncWrite(address, closeCommunicationWindow, sizeof(closeCommunicationWindow));
@@ -183,7 +183,5 @@ slave_result_t TouchpadDriver_Update(uint8_t uhkModuleDriverId)
 
 void TouchpadDriver_Disconnect(uint8_t uhkModuleDriverId)
 {
-    TouchpadEvents.x = 0;
-    TouchpadEvents.y = 0;
     phase = 0;
 }
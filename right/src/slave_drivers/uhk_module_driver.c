@@ -12,8 +12,15 @@
 #include "keymap.h"
 #include "debug.h"
 #include "macros.h"
+#include "timer.h"
+#include <stddef.h>
 
 uhk_module_state_t UhkModuleStates[UHK_MODULE_MAX_SLOT_COUNT];
+uint16_t UhkModuleScanPeriods[UHK_MODULE_MAX_SLOT_COUNT] = {
+    MODULE_DEFAULT_SCAN_PERIOD_USEC,
+    MODULE_DEFAULT_SCAN_PERIOD_USEC,
+    MODULE_DEFAULT_SCAN_PERIOD_USEC,
+};
 
 static bool shouldResetTrackpoint = false;
 
@@ -35,6 +42,11 @@ void UhkModuleSlaveDriver_ResetTrackpoint()
 static uint8_t keyStatesBuffer[MAX_KEY_COUNT_PER_MODULE];
 static i2c_message_t txMessage;
 
+// Filled by the slave scheduler interrupt, drained by the main loop.
+static uhk_module_key_event_t keyEvents[UHK_MODULE_KEY_EVENT_QUEUE_SIZE];
+static volatile uint8_t keyEventHead;
+static volatile uint8_t keyEventTail;
+
 static uhk_module_i2c_addresses_t moduleIdsToI2cAddresses[] = {
     { // UhkModuleDriverId_LeftKeyboardHalf
         .firmwareI2cAddress   = I2C_ADDRESS_LEFT_KEYBOARD_HALF_FIRMWARE,
@@ -50,6 +62,85 @@ static uhk_module_i2c_addresses_t moduleIdsToI2cAddresses[] = {
     },
 };
 
+uint8_t UhkModuleSlaveDriver_TakeKeyEvents(uhk_module_key_event_t *events, uint8_t maxCount)
+{
+    uint8_t count = 0;
+    while (keyEventTail != keyEventHead && count < maxCount) {
+        events[count++] = keyEvents[keyEventTail % UHK_MODULE_KEY_EVENT_QUEUE_SIZE];
+        keyEventTail++;
+    }
+    return count;
+}
+
+// The module time of a response is sampled when the module stages it, which may be a good while
+// before the master reads it. The smallest difference of the local and the module time within a
+// window of responses is the one of a response which got read right after staging, so it's taken
+// for the clock offset. The window restarts all the time, so that the offset follows the drift of
+// the module clock. Returns how long ago the response got staged in MODULE_KEY_EVENT_TICK_USEC units.
+static uint16_t syncModuleTime(uhk_module_time_sync_t *timeSync, uint16_t moduleTick, uint32_t nowMicros)
+{
+    uint32_t elapsedMicros = nowMicros - timeSync->lastMicros + timeSync->remainderMicros;
+    timeSync->lastMicros = nowMicros;
+    timeSync->localTick += elapsedMicros / MODULE_KEY_EVENT_TICK_USEC;
+    timeSync->remainderMicros = elapsedMicros % MODULE_KEY_EVENT_TICK_USEC;
+
+    uint16_t offset = timeSync->localTick - moduleTick;
+    if (timeSync->windowSampleCount == 0 || (int16_t)(offset - timeSync->windowOffset) < 0) {
+        timeSync->windowOffset = offset;
+    }
+    if (++timeSync->windowSampleCount == UHK_MODULE_TIME_SYNC_WINDOW) {
+        timeSync->windowSampleCount = 0;
+        timeSync->offset = timeSync->windowOffset;
+        timeSync->isSynced = true;
+    } else if (!timeSync->isSynced || (int16_t)(offset - timeSync->offset) < 0) {
+        timeSync->offset = timeSync->windowOffset;
+    }
+    return offset - timeSync->offset;
+}
+
+// Converts the module timestamps of the events into local time.
+static void queueKeyEvents(uhk_module_state_t *uhkModuleState, uint8_t slotId, uint8_t *data, uint8_t length)
+{
+    // Modules older than 4.4.0 don't send the sample tick.
+    bool hasSampleTick = VERSION_AT_LEAST(uhkModuleState->moduleProtocolVersion, 4, 4, 0);
+    uint8_t headerLength = hasSampleTick ? sizeof(module_key_events_header_t) : offsetof(module_key_events_header_t, sampleTick);
+    module_key_events_header_t *header = (module_key_events_header_t*)data;
+    module_key_event_t *events = (module_key_event_t*)(data + headerLength);
+    uint8_t keyCount = uhkModuleState->keyCount;
+    if (length < headerLength) {
+        return;
+    }
+
+    if (hasSampleTick) {
+        uhkModuleState->sampleAge = (uint16_t)(header->tick - header->sampleTick) * MODULE_KEY_EVENT_TICK_USEC;
+        uhkModuleState->maxSampleAge = MAX(uhkModuleState->maxSampleAge, uhkModuleState->sampleAge);
+    }
+    uint32_t nowMicros = Timer_GetCurrentTimeMicros();
+    uint32_t stagingAgeMicros = syncModuleTime(&uhkModuleState->timeSync, header->tick, nowMicros) * MODULE_KEY_EVENT_TICK_USEC;
+
+    uint8_t eventCount = header->eventCount & MODULE_KEY_EVENTS_COUNT_MASK;
+    if (length < headerLength + eventCount * sizeof(module_key_event_t)) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < eventCount; i++) {
+        module_key_event_t *event = events + i;
+        uint8_t keyId = event->keyIdAndState & MODULE_KEY_EVENT_KEY_ID_MASK;
+        if (keyId >= keyCount || (uint8_t)(keyEventHead - keyEventTail) >= UHK_MODULE_KEY_EVENT_QUEUE_SIZE) {
+            // The key states bitmap still gets the key to its final state.
+            continue;
+        }
+        uint32_t ageMicros = stagingAgeMicros + (uint16_t)(header->tick - event->tick) * MODULE_KEY_EVENT_TICK_USEC;
+        keyEvents[keyEventHead % UHK_MODULE_KEY_EVENT_QUEUE_SIZE] = (uhk_module_key_event_t) {
+            .keyState = &KeyStates[slotId][keyId],
+            .time = CurrentTime - ageMicros / 1000,
+            .timeMicros = nowMicros - ageMicros,
+            .active = event->keyIdAndState & MODULE_KEY_EVENT_PRESSED_MASK,
+        };
+        keyEventHead++;
+    }
+}
+
 static status_t tx(uint8_t i2cAddress)
 {
     return I2cAsyncWriteMessage(i2cAddress, &txMessage);
@@ -60,6 +151,11 @@ static status_t rx(i2c_message_t *rxMessage, uint8_t i2cAddress)
     return I2cAsyncReadMessage(i2cAddress, rxMessage);
 }
 
+static status_t txRx(i2c_message_t *rxMessage, uint8_t i2cAddress)
+{
+    return I2cAsyncWriteReadMessage(i2cAddress, &txMessage, rxMessage);
+}
+
 void UhkModuleSlaveDriver_Init(uint8_t uhkModuleDriverId)
 {
     uhk_module_state_t *uhkModuleState = UhkModuleStates + uhkModuleDriverId;
@@ -72,15 +168,17 @@ void UhkModuleSlaveDriver_Init(uint8_t uhkModuleDriverId)
     uhkModuleSourceVars->ledPwmBrightness = MAX_PWM_BRIGHTNESS;
     uhkModuleTargetVars->ledPwmBrightness = 0;
 
+    uhkModuleSourceVars->scanPeriod = UhkModuleScanPeriods[uhkModuleDriverId];
+    uhkModuleTargetVars->scanPeriod = MODULE_DEFAULT_SCAN_PERIOD_USEC;
+    uhkModuleState->maxSampleAge = 0;
+    memset(&uhkModuleState->timeSync, 0, sizeof(uhk_module_time_sync_t));
+
     uhk_module_phase_t *uhkModulePhase = &uhkModuleState->phase;
     *uhkModulePhase = UhkModulePhase_RequestSync;
 
     uhk_module_i2c_addresses_t *uhkModuleI2cAddresses = moduleIdsToI2cAddresses + uhkModuleDriverId;
     uhkModuleState->firmwareI2cAddress = uhkModuleI2cAddresses->firmwareI2cAddress;
     uhkModuleState->bootloaderI2cAddress = uhkModuleI2cAddresses->bootloaderI2cAddress;
-
-    uhkModuleState->pointerDelta.x = 0;
-    uhkModuleState->pointerDelta.y = 0;
 }
 
 // When module is swapped, we need to reload its Keymap once we know its
@@ -139,11 +237,55 @@ slave_result_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
             bool isSyncValid = memcmp(rxMessage->data, SlaveSyncString, SLAVE_SYNC_STRING_LENGTH) == 0;
             res.status = kStatus_Uhk_IdleCycle;
             *uhkModulePhase = isSyncValid && isMessageValid
-                ? UhkModulePhase_RequestModuleProtocolVersion
+                ? UhkModulePhase_RequestDescriptor
                 : UhkModulePhase_RequestSync;
             break;
         }
 
+        // Get module descriptor
+        case UhkModulePhase_RequestDescriptor:
+            txMessage.data[0] = SlaveCommand_RequestProperty;
+            txMessage.data[1] = SlaveProperty_Descriptor;
+            txMessage.length = 2;
+            res.status = tx(i2cAddress);
+            *uhkModulePhase = UhkModulePhase_ReceiveDescriptor;
+            break;
+        case UhkModulePhase_ReceiveDescriptor:
+            res.status = rx(rxMessage, i2cAddress);
+            *uhkModulePhase = UhkModulePhase_ProcessDescriptor;
+            break;
+        case UhkModulePhase_ProcessDescriptor: {
+            // Modules older than 4.5.0 don't know the property and resend their previous response,
+            // which the version check keeps from being taken for a descriptor.
+            module_descriptor_t *descriptor = (module_descriptor_t*)rxMessage->data;
+            bool isMessageValid =
+                CRC16_IsMessageValid(rxMessage) &&
+                rxMessage->length == sizeof(module_descriptor_t) &&
+                VERSION_AT_LEAST(descriptor->moduleProtocolVersion, 4, 5, 0);
+            res.status = kStatus_Uhk_IdleCycle;
+            if (!isMessageValid) {
+                uhkModuleState->hasDescriptorStrings = false;
+                *uhkModulePhase = UhkModulePhase_RequestModuleProtocolVersion;
+                break;
+            }
+
+            uhkModuleState->moduleProtocolVersion = descriptor->moduleProtocolVersion;
+            uhkModuleState->firmwareVersion = descriptor->firmwareVersion;
+            uhkModuleState->keyCount = descriptor->keyCount;
+            uhkModuleState->pointerCount = descriptor->pointerCount;
+            uhkModuleState->moduleId = descriptor->moduleId;
+            reloadKeymapIfNeeded();
+
+            if (uhkModuleState->hasDescriptorStrings && uhkModuleState->descriptorHash == descriptor->hash) {
+                *uhkModulePhase = UhkModulePhase_RequestKeyStates;
+            } else {
+                uhkModuleState->descriptorHash = descriptor->hash;
+                uhkModuleState->hasDescriptorStrings = false;
+                *uhkModulePhase = UhkModulePhase_RequestGitTag;
+            }
+            break;
+        }
+
         // Get module protocol version
         case UhkModulePhase_RequestModuleProtocolVersion:
             txMessage.data[0] = SlaveCommand_RequestProperty;
@@ -302,6 +444,8 @@ slave_result_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
             bool isMessageValid = CRC16_IsMessageValid(rxMessage);
             if (isMessageValid) {
                 Utils_SafeStrCopy(uhkModuleState->gitRepo, (const char*)rxMessage->data, sizeof(uhkModuleState->gitRepo));
+                // Only the strings of modules which sent a descriptor are cached under its hash.
+                uhkModuleState->hasDescriptorStrings = VERSION_AT_LEAST(uhkModuleState->moduleProtocolVersion, 4, 5, 0);
             }
             res.status = kStatus_Uhk_IdleCycle;
             *uhkModulePhase = isMessageValid ? UhkModulePhase_RequestKeyStates : UhkModulePhase_RequestGitRepo;
@@ -309,32 +453,38 @@ slave_result_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
         }
 
         // Update loop start
-        // Get key states
+        // Get key states, requested and received in a single transfer with a repeated start
         case UhkModulePhase_RequestKeyStates:
             txMessage.data[0] = SlaveCommand_RequestKeyStates;
             txMessage.length = 1;
-            res.status = tx(i2cAddress);
-            res.hold = true;
-            *uhkModulePhase = UhkModulePhase_ReceiveKeystates;
-            break;
-        case UhkModulePhase_ReceiveKeystates:
-            res.status = rx(rxMessage, i2cAddress);
+            res.status = txRx(rxMessage, i2cAddress);
             res.hold = true;
             *uhkModulePhase = UhkModulePhase_ProcessKeystates;
             break;
         case UhkModulePhase_ProcessKeystates:
             if (CRC16_IsMessageValid(rxMessage)) {
+                uint32_t pollTime = Timer_GetCurrentTimeMicros();
+                uhkModuleState->pollInterval = MIN(pollTime - uhkModuleState->lastPollTime, UINT16_MAX);
+                uhkModuleState->lastPollTime = pollTime;
                 uint8_t slotId = UhkModuleSlaveDriver_DriverIdToSlotId(uhkModuleDriverId);
                 BoolBitsToBytes(rxMessage->data, keyStatesBuffer, uhkModuleState->keyCount);
                 for (uint8_t keyId=0; keyId < uhkModuleState->keyCount; keyId++) {
                     KeyStates[slotId][keyId].hardwareSwitchState = keyStatesBuffer[keyId];
                 }
+                uint8_t messageLength = BOOL_BYTES_TO_BITS_COUNT(uhkModuleState->keyCount);
                 if (uhkModuleState->pointerCount) {
-                    uint8_t keyStatesLength = BOOL_BYTES_TO_BITS_COUNT(uhkModuleState->keyCount);
-                    pointer_delta_t *pointerDelta = (pointer_delta_t*)(rxMessage->data + keyStatesLength);
-                    uhkModuleState->pointerDelta.x += pointerDelta->x;
-                    uhkModuleState->pointerDelta.y += pointerDelta->y;
+                    pointer_delta_t *pointerDelta = (pointer_delta_t*)(rxMessage->data + messageLength);
+                    if (pointerDelta->x || pointerDelta->y) {
+                        PointerSource_Push(&uhkModuleState->pointerSource, pointerDelta->x, pointerDelta->y);
+                    }
+                    messageLength += sizeof(pointer_delta_t);
                 }
+                if (VERSION_AT_LEAST(uhkModuleState->moduleProtocolVersion, 4, 3, 0) && rxMessage->length > messageLength) {
+                    queueKeyEvents(uhkModuleState, slotId, rxMessage->data + messageLength, rxMessage->length - messageLength);
+                }
+            } else {
+                // Let the scheduler slow the bus down for this module.
+                ReportCorruptedSlaveTransfer(uhkModuleDriverId);
             }
             res.status = kStatus_Uhk_IdleCycle;
             res.hold = true;
@@ -354,6 +504,26 @@ slave_result_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
                 res.hold = true;
                 uhkModuleTargetVars->isTestLedOn = uhkModuleSourceVars->isTestLedOn;
             }
+            *uhkModulePhase = UhkModulePhase_SetScanPeriod;
+            break;
+
+        // Set scan period
+        case UhkModulePhase_SetScanPeriod:
+            if (
+                uhkModuleSourceVars->scanPeriod == uhkModuleTargetVars->scanPeriod ||
+                !VERSION_AT_LEAST(uhkModuleState->moduleProtocolVersion, 4, 4, 0)
+            ) {
+                res.status = kStatus_Uhk_IdleCycle;
+                res.hold = true;
+            } else {
+                txMessage.data[0] = SlaveCommand_SetScanPeriod;
+                *(uint16_t*)(txMessage.data + 1) = uhkModuleSourceVars->scanPeriod;
+                txMessage.length = 3;
+                res.status = tx(i2cAddress);
+                res.hold = true;
+                uhkModuleTargetVars->scanPeriod = uhkModuleSourceVars->scanPeriod;
+                uhkModuleState->maxSampleAge = 0;
+            }
             *uhkModulePhase = UhkModulePhase_SetLedPwmBrightness;
             break;
 
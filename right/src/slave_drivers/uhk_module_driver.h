@@ -9,6 +9,8 @@
     #include "versioning.h"
     #include "slot.h"
     #include "usb_interfaces/usb_interface_mouse.h"
+    #include "pointer_source.h"
+    #include "key_states.h"
 
 // Macros:
 
@@ -17,6 +19,9 @@
 
     #define MAX_STRING_PROPERTY_LENGTH 63
 
+    #define UHK_MODULE_KEY_EVENT_QUEUE_SIZE 16 // Must be a power of two
+    #define UHK_MODULE_TIME_SYNC_WINDOW 32 // Key states responses
+
 // Typedefs:
 
     typedef enum {
@@ -32,6 +37,11 @@
         UhkModulePhase_ReceiveSync,
         UhkModulePhase_ProcessSync,
 
+        // Get descriptor
+        UhkModulePhase_RequestDescriptor,
+        UhkModulePhase_ReceiveDescriptor,
+        UhkModulePhase_ProcessDescriptor,
+
         // Get protocol version
         UhkModulePhase_RequestModuleProtocolVersion,
         UhkModulePhase_ReceiveModuleProtocolVersion,
@@ -59,7 +69,6 @@
 
         // Get key states
         UhkModulePhase_RequestKeyStates,
-        UhkModulePhase_ReceiveKeystates,
         UhkModulePhase_ProcessKeystates,
 
         // Get git tag
@@ -74,6 +83,7 @@
 
         // Misc phases
         UhkModulePhase_SetTestLed,
+        UhkModulePhase_SetScanPeriod,
         UhkModulePhase_SetLedPwmBrightness,
         UhkModulePhase_JumpToBootloader,
         UhkModulePhase_ResetTrackpoint,
@@ -83,8 +93,20 @@
     typedef struct {
         uint8_t ledPwmBrightness;
         bool isTestLedOn;
+        uint16_t scanPeriod;
     } uhk_module_vars_t;
 
+    // Offset of the module clock from the local one, both counted in MODULE_KEY_EVENT_TICK_USEC units
+    typedef struct {
+        uint32_t lastMicros;
+        uint16_t remainderMicros;
+        uint16_t localTick;
+        uint16_t offset;
+        uint16_t windowOffset;
+        uint8_t windowSampleCount;
+        bool isSynced;
+    } uhk_module_time_sync_t;
+
     typedef struct {
         uint8_t moduleId;
         version_t moduleProtocolVersion;
@@ -97,9 +119,18 @@
         uint8_t bootloaderI2cAddress;
         uint8_t keyCount;
         uint8_t pointerCount;
-        pointer_delta_t pointerDelta;
+        pointer_source_t pointerSource;
         char gitRepo[MAX_STRING_PROPERTY_LENGTH];
         char gitTag[MAX_STRING_PROPERTY_LENGTH];
+        // Kept across reconnects, so that the strings needn't be fetched again
+        uint16_t descriptorHash;
+        bool hasDescriptorStrings;
+        // Scan timing in microseconds, measured at every key states response
+        uint16_t sampleAge;
+        uint16_t maxSampleAge;
+        uint16_t pollInterval;
+        uint32_t lastPollTime;
+        uhk_module_time_sync_t timeSync;
     } uhk_module_state_t;
 
     typedef struct {
@@ -107,9 +138,17 @@
         uint8_t bootloaderI2cAddress;
     } uhk_module_i2c_addresses_t;
 
+    typedef struct {
+        key_state_t *keyState;
+        uint32_t time; // In CurrentTime units
+        uint32_t timeMicros; // Only meant for ordering the events
+        bool active;
+    } uhk_module_key_event_t;
+
 // Variables:
 
     extern uhk_module_state_t UhkModuleStates[UHK_MODULE_MAX_SLOT_COUNT];
+    extern uint16_t UhkModuleScanPeriods[UHK_MODULE_MAX_SLOT_COUNT];
 
 // Functions:
 
@@ -121,5 +160,6 @@
     void UhkModuleSlaveDriver_Disconnect(uint8_t uhkModuleDriverId);
 
     void UhkModuleSlaveDriver_ResetTrackpoint();
+    uint8_t UhkModuleSlaveDriver_TakeKeyEvents(uhk_module_key_event_t *keyEvents, uint8_t maxCount);
 
 #endif
@@ -13,63 +13,181 @@
 #include "i2c_error_logger.h"
 #include "macros.h"
 #include "debug.h"
+#include "timer.h"
+#include "init_peripherals.h"
 
 uint32_t I2cSlaveScheduler_Counter;
+uint16_t SlaveProbeMaxInterval = SLAVE_PROBE_DEFAULT_MAX_INTERVAL;
+uint32_t SlaveStatsResetTime;
 
 static uint8_t previousSlaveId;
 static uint8_t currentSlaveId;
+static uint8_t currentBaudRateIdx;
+static uint8_t polledSlaveId = SLAVE_COUNT;
+static bool isPollHeld;
 
+// Slaves start at the datasheet maximum of their IC. The LED driver slots may hold an IS31FL3731 or
+// IS31FL3199, both of which are 400 kHz parts, and the KL03 ROM bootloader is kept at the rate it has
+// always been driven at. Only the UHK modules, whose messages carry a CRC, probe faster rates.
 uhk_slave_t Slaves[SLAVE_COUNT] = {
     {
         .init = UhkModuleSlaveDriver_Init,
         .update = UhkModuleSlaveDriver_Update,
         .disconnect = UhkModuleSlaveDriver_Disconnect,
         .perDriverId = UhkModuleDriverId_LeftKeyboardHalf,
+        .baudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .defaultBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .fastestBaudRateIdx = I2cMainBusBaudRateIdx_FastModePlus,
     },
     {
         .init = UhkModuleSlaveDriver_Init,
         .update = UhkModuleSlaveDriver_Update,
         .disconnect = UhkModuleSlaveDriver_Disconnect,
         .perDriverId = UhkModuleDriverId_LeftModule,
+        .baudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .defaultBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .fastestBaudRateIdx = I2cMainBusBaudRateIdx_FastModePlus,
     },
     {
         .init = UhkModuleSlaveDriver_Init,
         .update = UhkModuleSlaveDriver_Update,
         .disconnect = UhkModuleSlaveDriver_Disconnect,
         .perDriverId = UhkModuleDriverId_RightModule,
+        .baudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .defaultBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .fastestBaudRateIdx = I2cMainBusBaudRateIdx_FastModePlus,
     },
     {
         .init = TouchpadDriver_Init,
         .update = TouchpadDriver_Update,
         .disconnect = TouchpadDriver_Disconnect,
         .perDriverId = TouchpadDriverId_Singleton,
+        .baudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .defaultBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .fastestBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
     },
     {
         .init = LedSlaveDriver_Init,
         .update = LedSlaveDriver_Update,
         .perDriverId = LedDriverId_Right,
+        .baudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .defaultBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .fastestBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
     },
     {
         .init = LedSlaveDriver_Init,
         .update = LedSlaveDriver_Update,
         .perDriverId = LedDriverId_Left,
+        .baudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .defaultBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .fastestBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
     },
     {
         .init = LedSlaveDriver_Init,
         .update = LedSlaveDriver_Update,
         .perDriverId = LedDriverId_ModuleLeft,
+        .baudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .defaultBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
+        .fastestBaudRateIdx = I2cMainBusBaudRateIdx_FastMode,
     },
     {
         .init = KbootSlaveDriver_Init,
         .update = KbootSlaveDriver_Update,
         .perDriverId = KbootDriverId_Singleton,
+        .baudRateIdx = I2cMainBusBaudRateIdx_Normal,
+        .defaultBaudRateIdx = I2cMainBusBaudRateIdx_Normal,
+        .fastestBaudRateIdx = I2cMainBusBaudRateIdx_Normal,
     },
 };
 
+static void backOffProbing(uhk_slave_t *slave)
+{
+    slave->nextProbeTime = CurrentTime + slave->probeInterval;
+    slave->probeInterval = MIN(MAX(2*slave->probeInterval, 1), SlaveProbeMaxInterval);
+}
+
+static bool isProbeDue(uhk_slave_t *slave)
+{
+    return (int32_t)(CurrentTime - slave->nextProbeTime) >= 0;
+}
+
+static void resetBaudRateWindow(uhk_slave_t *slave)
+{
+    slave->windowTransferCount = 0;
+    slave->windowErrorCount = 0;
+}
+
+static void updateBaudRateWindow(uhk_slave_t *slave, status_t status)
+{
+    slave->windowTransferCount++;
+    if (IS_STATUS_I2C_ERROR(status)) {
+        slave->windowErrorCount++;
+    }
+
+    if (slave->windowErrorCount >= SLAVE_BAUD_RATE_WINDOW_MAX_ERROR_COUNT) {
+        if (slave->baudRateIdx < I2C_MAIN_BUS_BAUD_RATE_COUNT - 1) {
+            slave->baudRateIdx++;
+            slave->baudRateStepDownCount++;
+        }
+        slave->errorFreeWindowCount = 0;
+        resetBaudRateWindow(slave);
+    } else if (slave->windowTransferCount >= SLAVE_BAUD_RATE_WINDOW_TRANSFER_COUNT) {
+        slave->errorFreeWindowCount = slave->windowErrorCount == 0 ? slave->errorFreeWindowCount + 1 : 0;
+        uint8_t stepUpBackoff = MIN(slave->baudRateStepDownCount, SLAVE_BAUD_RATE_MAX_STEP_UP_BACKOFF);
+        if (slave->baudRateIdx > slave->fastestBaudRateIdx && slave->errorFreeWindowCount >= SLAVE_BAUD_RATE_STEP_UP_WINDOW_COUNT << stepUpBackoff) {
+            slave->baudRateIdx--;
+            slave->errorFreeWindowCount = 0;
+        }
+        resetBaudRateWindow(slave);
+    }
+}
+
+// Probes of disconnected slaves cycle through the rates from their default one down, so that a slave
+// which can't keep up with it still gets found.
+static void cycleProbeBaudRate(uhk_slave_t *slave)
+{
+    if (++slave->baudRateIdx >= I2C_MAIN_BUS_BAUD_RATE_COUNT || slave->baudRateIdx < slave->defaultBaudRateIdx) {
+        slave->baudRateIdx = slave->defaultBaudRateIdx;
+    }
+    slave->errorFreeWindowCount = 0;
+    resetBaudRateWindow(slave);
+}
+
+// Called by drivers whose transfer succeeded on the bus but carried a message with an invalid CRC.
+void ReportCorruptedSlaveTransfer(uint8_t slaveId)
+{
+    Slaves[slaveId].windowErrorCount++;
+}
+
+static void recordTransfer(uhk_slave_t *slave, status_t status)
+{
+    slave_stats_t *stats = &slave->stats;
+    stats->transferCount++;
+    stats->byteCount += I2cGetTransferByteCount();
+    stats->busTime += Timer_GetCurrentTimeMicros() - I2cTransferStartTime;
+    if (IS_STATUS_I2C_ERROR(status)) {
+        stats->errorCount++;
+    }
+}
+
+static void recordPoll(uhk_slave_t *slave)
+{
+    slave_stats_t *stats = &slave->stats;
+    if (stats->isLastPollTimeValid) {
+        uint32_t pollInterval = I2cTransferStartTime - stats->lastPollTime;
+        stats->pollCount++;
+        stats->pollIntervalSum += pollInterval;
+        stats->maxPollInterval = MAX(stats->maxPollInterval, pollInterval);
+    }
+    stats->lastPollTime = I2cTransferStartTime;
+    stats->isLastPollTimeValid = slave->isConnected;
+}
+
 static void slaveSchedulerCallback(I2C_Type *base, i2c_master_handle_t *handle, status_t previousStatus, void *userData)
 {
     bool isFirstCycle = true;
     bool isTransferScheduled = false;
+    uint8_t skippedSlaveCount = 0;
     I2cSlaveScheduler_Counter++;
 
     do {
@@ -82,19 +200,50 @@ static void slaveSchedulerCallback(I2C_Type *base, i2c_master_handle_t *handle,
                 LogI2cError(previousSlaveId, previousStatus);
             }
 
+            // kStatus_Fail only comes from the kickstart of the scheduler, where no transfer happened.
+            if (previousStatus != kStatus_Fail) {
+                recordTransfer(previousSlave, previousStatus);
+            }
+
             bool wasPreviousSlaveConnected = previousSlave->isConnected;
             previousSlave->isConnected = previousStatus == kStatus_Success;
             if (wasPreviousSlaveConnected && !previousSlave->isConnected && previousSlave->disconnect) {
                 previousSlave->disconnect(previousSlave->perDriverId);
             }
+            if (previousSlave->isConnected) {
+                previousSlave->probeInterval = 0;
+            } else {
+                backOffProbing(previousSlave);
+                previousSlave->stats.isLastPollTimeValid = false;
+            }
+
+            if (wasPreviousSlaveConnected) {
+                updateBaudRateWindow(previousSlave, previousStatus);
+            } else if (!previousSlave->isConnected && previousStatus != kStatus_Fail) {
+                cycleProbeBaudRate(previousSlave);
+            }
 
             isFirstCycle = false;
         }
 
+        // Skip disconnected slaves which are backing off, unless no slave would get scheduled at all.
+        if (!currentSlave->isConnected && !isProbeDue(currentSlave) && skippedSlaveCount < SLAVE_COUNT) {
+            skippedSlaveCount++;
+            if (++currentSlaveId >= SLAVE_COUNT) {
+                currentSlaveId = 0;
+            }
+            continue;
+        }
+
         if (!currentSlave->isConnected) {
             currentSlave->init(currentSlave->perDriverId);
         }
 
+        if (currentSlave->baudRateIdx != currentBaudRateIdx) {
+            currentBaudRateIdx = currentSlave->baudRateIdx;
+            SetI2cMainBusBaudRate(currentBaudRateIdx);
+        }
+
         slave_result_t res = currentSlave->update(currentSlave->perDriverId);
         status_t currentStatus = res.status;
         if (IS_STATUS_I2C_ERROR(currentStatus)) {
@@ -102,6 +251,13 @@ static void slaveSchedulerCallback(I2C_Type *base, i2c_master_handle_t *handle,
         }
 
         isTransferScheduled = currentStatus != kStatus_Uhk_IdleSlave && currentStatus != kStatus_Uhk_IdleCycle;
+        if (isTransferScheduled) {
+            if (currentSlaveId != polledSlaveId || !isPollHeld) {
+                recordPoll(currentSlave);
+            }
+            polledSlaveId = currentSlaveId;
+            isPollHeld = res.hold;
+        }
 
         if (!res.hold || !currentSlave->isConnected) {
             previousSlaveId = currentSlaveId++;
@@ -115,10 +271,31 @@ static void slaveSchedulerCallback(I2C_Type *base, i2c_master_handle_t *handle,
     } while (!isTransferScheduled);
 }
 
+void ResetSlaveBaudRates(void)
+{
+    for (uint8_t i=0; i<SLAVE_COUNT; i++) {
+        uhk_slave_t *slave = Slaves + i;
+        slave->baudRateIdx = slave->defaultBaudRateIdx;
+        slave->baudRateStepDownCount = 0;
+        slave->errorFreeWindowCount = 0;
+        resetBaudRateWindow(slave);
+    }
+}
+
+void ResetSlaveStats(void)
+{
+    for (uint8_t i=0; i<SLAVE_COUNT; i++) {
+        memset(&Slaves[i].stats, 0, sizeof(slave_stats_t));
+    }
+    SlaveStatsResetTime = Timer_GetCurrentTimeMicros();
+}
+
 void InitSlaveScheduler(void)
 {
     previousSlaveId = 0;
     currentSlaveId = 0;
+    // The bus has just been (re)initialized at the requested rate, so force the first slave to set its own.
+    currentBaudRateIdx = I2C_MAIN_BUS_BAUD_RATE_COUNT;
 
     for (uint8_t i=0; i<SLAVE_COUNT; i++) {
         uhk_slave_t *currentSlave = Slaves + i;
@@ -126,7 +303,11 @@ void InitSlaveScheduler(void)
             currentSlave->disconnect(currentSlave->perDriverId);
         }
         currentSlave->isConnected = false;
+        currentSlave->probeInterval = 0;
+        currentSlave->nextProbeTime = CurrentTime;
+        currentSlave->stats.isLastPollTimeValid = false;
     }
+    polledSlaveId = SLAVE_COUNT;
 
     I2C_MasterTransferCreateHandle(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, slaveSchedulerCallback, NULL);
 
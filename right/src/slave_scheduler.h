@@ -11,6 +11,15 @@
     #define SLAVE_COUNT 8
     #define IS_VALID_SLAVE_ID(slaveId) (0 <= slaveId && slaveId < SLAVE_COUNT)
     #define IS_STATUS_I2C_ERROR(status) (kStatus_I2C_Busy <= status && status <= kStatus_I2C_Timeout)
+    #define SLAVE_PROBE_DEFAULT_MAX_INTERVAL 500
+    // Bounds of the configurable max interval in ms, so that a disconnected slave gets probed at some pace.
+    #define SLAVE_PROBE_MIN_MAX_INTERVAL 1
+    #define SLAVE_PROBE_MAX_MAX_INTERVAL 10000
+    #define SLAVE_BAUD_RATE_WINDOW_TRANSFER_COUNT 64
+    #define SLAVE_BAUD_RATE_WINDOW_MAX_ERROR_COUNT 4
+    // Error free windows after which a slave tries the next faster rate, doubled with every step down.
+    #define SLAVE_BAUD_RATE_STEP_UP_WINDOW_COUNT 16
+    #define SLAVE_BAUD_RATE_MAX_STEP_UP_BACKOFF 6
 
 // Typedefs:
 
@@ -34,6 +43,20 @@
     typedef slave_result_t (slave_update_t)(uint8_t);
     typedef void (slave_disconnect_t)(uint8_t);
 
+    // Times are in microseconds. The counters wrap around, so consumers should chart their differences.
+    typedef struct {
+        uint32_t transferCount;
+        uint32_t byteCount;
+        uint32_t busTime;
+        uint32_t errorCount;
+        // A poll is a turn of a connected slave on the bus, spanning its consecutive transfers.
+        uint32_t pollCount;
+        uint64_t pollIntervalSum;
+        uint32_t maxPollInterval;
+        uint32_t lastPollTime;
+        bool isLastPollTimeValid;
+    } slave_stats_t;
+
     typedef struct {
         uint8_t perDriverId;  // Identifies the slave instance on a per-driver basis
         slave_init_t *init;
@@ -41,6 +64,21 @@
         slave_disconnect_t *disconnect;
         bool isConnected;
         status_t previousStatus;
+        // Disconnected slaves are probed with an exponentially growing interval.
+        uint32_t nextProbeTime;
+        uint16_t probeInterval;
+        // Index into I2cMainBusBaudRates, stepped down when too many transfers of a window fail.
+        uint8_t baudRateIdx;
+        // The datasheet maximum of the slave, which it starts at.
+        uint8_t defaultBaudRateIdx;
+        // Only slaves whose messages are CRC protected, so that corruption shows up as errors, step
+        // up beyond their default rate.
+        uint8_t fastestBaudRateIdx;
+        uint8_t windowTransferCount;
+        uint8_t windowErrorCount;
+        uint16_t errorFreeWindowCount;
+        uint8_t baudRateStepDownCount;
+        slave_stats_t stats;
     } uhk_slave_t;
 
     typedef enum {
@@ -56,9 +94,14 @@
 
     extern uhk_slave_t Slaves[SLAVE_COUNT];
     extern uint32_t I2cSlaveScheduler_Counter;
+    extern uint16_t SlaveProbeMaxInterval;
+    extern uint32_t SlaveStatsResetTime;
 
 // Functions:
 
     void InitSlaveScheduler(void);
+    void ResetSlaveBaudRates(void);
+    void ReportCorruptedSlaveTransfer(uint8_t slaveId);
+    void ResetSlaveStats(void);
 
 #endif
@@ -6,6 +6,7 @@
 #include "keymap.h"
 #include "macro_events.h"
 #include "macros.h"
+#include "timer.h"
 
 void updateUsbBuffer(uint8_t usbStatusCode, uint16_t parserOffset, parser_stage_t parserStage)
 {
@@ -14,18 +15,20 @@ void updateUsbBuffer(uint8_t usbStatusCode, uint16_t parserOffset, parser_stage_
     SetUsbTxBufferUint8(3, parserStage);
 }
 
-void UsbCommand_ApplyConfig(void)
+static void applyConfig(void)
 {
-    // Validate the staging configuration.
+    // Validate the staging configuration and stage the parsed values.
 
     ParserRunDry = true;
     StagingUserConfigBuffer.offset = 0;
-    uint8_t parseConfigStatus = ParseConfig(&StagingUserConfigBuffer);
-    updateUsbBuffer(parseConfigStatus, StagingUserConfigBuffer.offset, ParsingStage_Validate);
+    parser_error_t parseConfigStatus = ParseConfig(&StagingUserConfigBuffer);
+    ParserRunDry = false;
 
-    if (parseConfigStatus != UsbStatusCode_Success) {
+    if (parseConfigStatus != ParserError_Success) {
+        updateUsbBuffer(parseConfigStatus, StagingUserConfigBuffer.offset, ParsingStage_Validate);
         return;
     }
+    updateUsbBuffer(parseConfigStatus, StagingUserConfigBuffer.offset, ParsingStage_Apply);
 
     // Make the staging configuration the current one.
 
@@ -33,6 +36,8 @@ void UsbCommand_ApplyConfig(void)
     uint8_t oldKeymapAbbreviationLen;
     memcpy(oldKeymapAbbreviation, AllKeymaps[CurrentKeymapIndex].abbreviation, KEYMAP_ABBREVIATION_LENGTH);
     oldKeymapAbbreviationLen = AllKeymaps[CurrentKeymapIndex].abbreviationLen;
+    config_section_t oldKeymapSection = AllKeymaps[CurrentKeymapIndex].section;
+    uint8_t oldKeymapIndex = CurrentKeymapIndex;
 
     uint8_t *temp = ValidatedUserConfigBuffer.buffer;
     ValidatedUserConfigBuffer.buffer = StagingUserConfigBuffer.buffer;
@@ -42,23 +47,28 @@ void UsbCommand_ApplyConfig(void)
         return;
     }
 
-    ParserRunDry = false;
-    ValidatedUserConfigBuffer.offset = 0;
-    parseConfigStatus = ParseConfig(&ValidatedUserConfigBuffer);
-    updateUsbBuffer(parseConfigStatus, ValidatedUserConfigBuffer.offset, ParsingStage_Apply);
+    // Running macros survive the update if none of the macros has changed.
+    if (ApplyStagingConfig()) {
+        Macros_ClearStatus();
 
-    if (parseConfigStatus != UsbStatusCode_Success) {
-        return;
+        MacroEvent_OnInit();
+    } else {
+        Macros_RebaseConfigPointers(StagingUserConfigBuffer.buffer, ValidatedUserConfigBuffer.buffer);
     }
 
-    Macros_ClearStatus();
-
-    MacroEvent_OnInit();
-
     // Switch to the keymap of the updated configuration of the same name or the default keymap.
-    if (SwitchKeymapByAbbreviation(oldKeymapAbbreviationLen, oldKeymapAbbreviation)) {
-        return;
+    uint8_t keymapIndex = FindKeymapByAbbreviation(oldKeymapAbbreviationLen, oldKeymapAbbreviation);
+
+    if (keymapIndex == 0xFF) {
+        SwitchKeymapById(DefaultKeymapIndex);
+    } else if (keymapIndex != oldKeymapIndex || !ConfigSectionsEqual(&oldKeymapSection, &AllKeymaps[keymapIndex].section)) {
+        SwitchKeymapById(keymapIndex);
     }
+}
 
-    SwitchKeymapById(DefaultKeymapIndex);
+void UsbCommand_ApplyConfig(void)
+{
+    uint32_t startTime = Timer_GetCurrentTimeMicros();
+    applyConfig();
+    SetUsbTxBufferUint32(4, Timer_GetElapsedTimeMicros(&startTime));
 }
@@ -0,0 +1,184 @@
+#include "fsl_common.h"
+#include "usb_commands/usb_command_config_transfer.h"
+#include "usb_protocol_handler.h"
+#include "eeprom.h"
+#include "crc16.h"
+
+/**
+ * Windowed configuration upload. The host may keep several chunks in flight.
+ * Every chunk carries its offset within the transferred stream and is answered
+ * by the offset the device expects next, so a lost or reordered chunk is
+ * detected and the host resends from the acknowledged offset.
+ *
+ * The stream is optionally compressed (see the tokens in the header) and is
+ * checked against the CRC16 of the decompressed data once it is complete.
+ */
+
+typedef enum {
+    DecoderState_Token,
+    DecoderState_Literal,
+    DecoderState_DistanceLow,
+    DecoderState_DistanceHigh,
+} decoder_state_t;
+
+typedef struct {
+    bool isActive;
+    bool isCompressed;
+    uint8_t *buffer;
+    uint16_t length;
+    uint16_t crc;
+    uint16_t streamOffset;
+    uint16_t outputOffset;
+    decoder_state_t decoderState;
+    uint8_t runLength;
+    uint16_t distance;
+} config_transfer_t;
+
+static config_transfer_t transfer;
+
+static bool outputByte(uint8_t byte)
+{
+    if (transfer.outputOffset >= transfer.length) {
+        return false;
+    }
+    transfer.buffer[transfer.outputOffset++] = byte;
+    return true;
+}
+
+static bool copyMatch(void)
+{
+    if (transfer.distance == 0 || transfer.distance > transfer.outputOffset) {
+        return false;
+    }
+    for (uint8_t i = 0; i < transfer.runLength; i++) {
+        if (!outputByte(transfer.buffer[transfer.outputOffset - transfer.distance])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool decodeByte(uint8_t byte)
+{
+    switch (transfer.decoderState) {
+        case DecoderState_Token:
+            if (byte & CONFIG_TRANSFER_MATCH_FLAG) {
+                transfer.runLength = (byte & CONFIG_TRANSFER_LENGTH_MASK) + CONFIG_TRANSFER_MIN_MATCH_LENGTH;
+                transfer.decoderState = DecoderState_DistanceLow;
+            } else {
+                transfer.runLength = byte + 1;
+                transfer.decoderState = DecoderState_Literal;
+            }
+            return true;
+        case DecoderState_Literal:
+            if (--transfer.runLength == 0) {
+                transfer.decoderState = DecoderState_Token;
+            }
+            return outputByte(byte);
+        case DecoderState_DistanceLow:
+            transfer.distance = byte;
+            transfer.decoderState = DecoderState_DistanceHigh;
+            return true;
+        case DecoderState_DistanceHigh:
+            transfer.distance |= byte << 8;
+            transfer.decoderState = DecoderState_Token;
+            return copyMatch();
+    }
+    return false;
+}
+
+void UsbCommand_StartConfigTransfer(void)
+{
+    config_buffer_id_t configBufferId = GetUsbRxBufferUint8(1);
+    uint8_t flags = GetUsbRxBufferUint8(2);
+    uint16_t length = GetUsbRxBufferUint16(3);
+    uint16_t crc = GetUsbRxBufferUint16(5);
+
+    transfer.isActive = false;
+
+    if (configBufferId != ConfigBufferId_HardwareConfig && configBufferId != ConfigBufferId_StagingUserConfig) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_ConfigTransfer_InvalidConfigBufferId);
+        return;
+    }
+
+    if (length > ConfigBufferIdToBufferSize(configBufferId)) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_ConfigTransfer_BufferOutOfBounds);
+        return;
+    }
+
+    transfer = (config_transfer_t) {
+        .isActive = true,
+        .isCompressed = flags & CONFIG_TRANSFER_FLAG_COMPRESSED,
+        .buffer = ConfigBufferIdToConfigBuffer(configBufferId)->buffer,
+        .length = length,
+        .crc = crc,
+        .decoderState = DecoderState_Token,
+    };
+}
+
+void UsbCommand_WriteConfigChunk(void)
+{
+    uint8_t length = GetUsbRxBufferUint8(1);
+    uint16_t offset = GetUsbRxBufferUint16(2);
+    const uint8_t paramsSize = USB_STATUS_CODE_SIZE + sizeof(length) + sizeof(offset);
+
+    if (!transfer.isActive) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_ConfigTransfer_NotStarted);
+        return;
+    }
+
+    if (length > USB_GENERIC_HID_OUT_BUFFER_LENGTH - paramsSize) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_ConfigTransfer_LengthTooLarge);
+        return;
+    }
+
+    // Chunks are only accepted in order; the host resends from the acknowledged offset.
+    if (offset != transfer.streamOffset) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_ConfigTransfer_UnexpectedOffset);
+        SetUsbTxBufferUint16(1, transfer.streamOffset);
+        return;
+    }
+
+    const uint8_t *data = GenericHidOutBuffer + paramsSize;
+    uint16_t outputOffset = transfer.outputOffset;
+    for (uint8_t i = 0; i < length; i++) {
+        bool isValid = transfer.isCompressed ? decodeByte(data[i]) : outputByte(data[i]);
+        if (!isValid) {
+            ConfigBuffer_MarkChanged(transfer.buffer, outputOffset, transfer.outputOffset - outputOffset);
+            transfer.isActive = false;
+            SetUsbTxBufferUint8(0, UsbStatusCode_ConfigTransfer_InvalidStream);
+            return;
+        }
+    }
+
+    ConfigBuffer_MarkChanged(transfer.buffer, outputOffset, transfer.outputOffset - outputOffset);
+    transfer.streamOffset += length;
+    SetUsbTxBufferUint16(1, transfer.streamOffset);
+}
+
+void UsbCommand_FinishConfigTransfer(void)
+{
+    if (!transfer.isActive) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_ConfigTransfer_NotStarted);
+        return;
+    }
+
+    transfer.isActive = false;
+
+    if (transfer.outputOffset != transfer.length || transfer.decoderState != DecoderState_Token) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_ConfigTransfer_Incomplete);
+        SetUsbTxBufferUint16(1, transfer.outputOffset);
+        return;
+    }
+
+    uint16_t crc;
+    crc16_data_t crc16Data;
+    crc16_init(&crc16Data);
+    crc16_update(&crc16Data, transfer.buffer, transfer.length);
+    crc16_finalize(&crc16Data, &crc);
+
+    SetUsbTxBufferUint16(1, crc);
+    if (crc != transfer.crc) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_ConfigTransfer_CrcMismatch);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef __USB_COMMAND_CONFIG_TRANSFER_H__
+#define __USB_COMMAND_CONFIG_TRANSFER_H__
+
+// Includes:
+
+    #include "config_parser/config_globals.h"
+
+// Macros:
+
+    #define CONFIG_TRANSFER_FLAG_COMPRESSED 0x01
+
+    // Tokens of the compressed stream. A literal token is followed by 1 to 128 bytes to be copied
+    // to the output, a match token by a uint16 distance of the earlier output to be repeated.
+    #define CONFIG_TRANSFER_MATCH_FLAG 0x80
+    #define CONFIG_TRANSFER_LENGTH_MASK 0x7f
+    #define CONFIG_TRANSFER_MIN_MATCH_LENGTH 3
+
+// Typedefs:
+
+    typedef enum {
+        UsbStatusCode_ConfigTransfer_InvalidConfigBufferId = 2,
+        UsbStatusCode_ConfigTransfer_BufferOutOfBounds     = 3,
+        UsbStatusCode_ConfigTransfer_NotStarted            = 4,
+        UsbStatusCode_ConfigTransfer_LengthTooLarge        = 5,
+        UsbStatusCode_ConfigTransfer_UnexpectedOffset      = 6,
+        UsbStatusCode_ConfigTransfer_InvalidStream         = 7,
+        UsbStatusCode_ConfigTransfer_Incomplete            = 8,
+        UsbStatusCode_ConfigTransfer_CrcMismatch           = 9,
+    } usb_status_code_config_transfer_t;
+
+// Functions:
+
+    void UsbCommand_StartConfigTransfer(void);
+    void UsbCommand_WriteConfigChunk(void);
+    void UsbCommand_FinishConfigTransfer(void);
+
+#endif
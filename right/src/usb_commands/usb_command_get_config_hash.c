@@ -0,0 +1,13 @@
+#include "fsl_common.h"
+#include "usb_commands/usb_command_get_config_hash.h"
+#include "usb_protocol_handler.h"
+#include "config_parser/config_globals.h"
+#include "eeprom.h"
+
+void UsbCommand_GetConfigHash(void)
+{
+    SetUsbTxBufferUint16(1, ValidatedUserConfigLength);
+    SetUsbTxBufferUint64(3, ConfigBuffer_Hash(ValidatedUserConfigBuffer.buffer, ValidatedUserConfigLength));
+    SetUsbTxBufferUint16(11, HARDWARE_CONFIG_SIZE);
+    SetUsbTxBufferUint64(13, ConfigBuffer_Hash(HardwareConfigBuffer.buffer, HARDWARE_CONFIG_SIZE));
+}
@@ -30,6 +30,7 @@ void UsbCommand_GetDebugBuffer(void)
     SetDebugBufferUint32(41, UsbSystemKeyboardActionCounter);
     SetDebugBufferUint32(45, UsbMouseActionCounter);
     SetDebugBufferUint32(49, UsbGamepadActionCounter);
+    SetDebugBufferUint32(53, WakeUpPreservedEventCount);
 
     memcpy(GenericHidInBuffer, DebugBuffer, USB_GENERIC_HID_IN_BUFFER_LENGTH);
 }
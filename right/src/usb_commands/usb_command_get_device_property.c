@@ -9,6 +9,7 @@
 #include "fsl_i2c.h"
 #include "timer.h"
 #include "utils.h"
+#include "boot_phases.h"
 
 version_t deviceProtocolVersion = {
     DEVICE_PROTOCOL_MAJOR_VERSION,
@@ -83,6 +84,9 @@ void UsbCommand_GetDeviceProperty(void)
         case DevicePropertyId_GitRepo:
             Utils_SafeStrCopy(((char*)GenericHidInBuffer) + 1, GIT_REPO, sizeof(GenericHidInBuffer)-1);
             break;
+        case DevicePropertyId_BootPhaseTimestamps:
+            memcpy(GenericHidInBuffer+1, (uint8_t*)&BootPhaseTimestamps, sizeof(BootPhaseTimestamps));
+            break;
         default:
             SetUsbTxBufferUint8(0, UsbStatusCode_GetDeviceProperty_InvalidProperty);
             break;
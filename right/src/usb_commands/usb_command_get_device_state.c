@@ -20,5 +20,9 @@ void UsbCommand_GetKeyboardState(void)
         : UhkModuleStates[UhkModuleDriverId_RightModule].moduleId;
     SetUsbTxBufferUint8(5, rightSlotModuleId);
     SetUsbTxBufferUint8(6, ActiveLayer | (ActiveLayer != LayerId_Base && !ActiveLayerHeld ? (1 << 7) : 0) ); //Active layer + most significant bit if layer is toggled
+    // Outcome of the last EEPROM write
+    SetUsbTxBufferUint16(7, EepromWriteStats.writtenPageCount);
+    SetUsbTxBufferUint16(9, EepromWriteStats.skippedPageCount);
+    SetUsbTxBufferUint32(11, EepromWriteStats.duration);
     LastUsbGetKeyboardStateRequestTimestamp = CurrentTime;
 }
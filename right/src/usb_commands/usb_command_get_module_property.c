@@ -36,5 +36,14 @@ void UsbCommand_GetModuleProperty()
             Utils_SafeStrCopy(((char*)GenericHidInBuffer) + 1, moduleState->gitRepo, sizeof(GenericHidInBuffer) - 1);
             break;
         }
+        case ModulePropertyId_ScanTiming: {
+            uint8_t moduleDriverId = UhkModuleSlaveDriver_SlotIdToDriverId(slotId);
+            uhk_module_state_t *moduleState = UhkModuleStates + moduleDriverId;
+            SetUsbTxBufferUint16(1, moduleState->targetVars.scanPeriod);
+            SetUsbTxBufferUint16(3, moduleState->sampleAge);
+            SetUsbTxBufferUint16(5, moduleState->maxSampleAge);
+            SetUsbTxBufferUint16(7, moduleState->pollInterval);
+            break;
+        }
     }
 }
@@ -11,6 +11,7 @@
         ModulePropertyId_VersionNumbers = 0,
         ModulePropertyId_GitTag = 1,
         ModulePropertyId_GitRepo = 2,
+        ModulePropertyId_ScanTiming = 3,
     } module_property_id_t;
 
     typedef enum {
@@ -3,6 +3,7 @@
 #include "usb_protocol_handler.h"
 #include "slave_scheduler.h"
 #include "i2c_error_logger.h"
+#include "init_peripherals.h"
 
 void UsbCommand_GetSlaveI2cErrors()
 {
@@ -16,4 +17,9 @@ void UsbCommand_GetSlaveI2cErrors()
 
     GenericHidInBuffer[1] = i2cSlaveErrorCounter->errorTypeCount;
     memcpy(GenericHidInBuffer + 2, i2cSlaveErrorCounter->errors, sizeof(i2c_error_count_t) * MAX_LOGGED_I2C_ERROR_TYPES_PER_SLAVE);
+
+    uhk_slave_t *slave = Slaves + slaveId;
+    SetUsbTxBufferUint32(58, GetI2cMainBusBaudRate(slave->baudRateIdx));
+    SetUsbTxBufferUint8(62, slave->baudRateStepDownCount);
+    SetUsbTxBufferUint8(63, slave->windowErrorCount);
 }
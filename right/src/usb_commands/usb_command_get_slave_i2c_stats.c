@@ -0,0 +1,42 @@
+#include "fsl_common.h"
+#include "usb_commands/usb_command_get_slave_i2c_stats.h"
+#include "usb_protocol_handler.h"
+#include "slave_scheduler.h"
+#include "slave_drivers/uhk_module_driver.h"
+#include "init_peripherals.h"
+#include "timer.h"
+
+void UsbCommand_GetSlaveI2cStats(void)
+{
+    uint8_t slaveId = GetUsbRxBufferUint8(1);
+    uint8_t flags = GetUsbRxBufferUint8(2);
+
+    if (!IS_VALID_SLAVE_ID(slaveId)) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_GetSlaveI2cStats_InvalidSlaveId);
+        return;
+    }
+
+    uhk_slave_t *slave = Slaves + slaveId;
+
+    // The scheduler updates the stats from the I2C interrupt.
+    __disable_irq();
+    slave_stats_t stats = slave->stats;
+    uint32_t resetTime = SlaveStatsResetTime;
+    if (flags & GET_SLAVE_I2C_STATS_FLAG_RESET) {
+        ResetSlaveStats();
+    }
+    __enable_irq();
+
+    SetUsbTxBufferUint32(1, stats.transferCount);
+    SetUsbTxBufferUint32(5, stats.byteCount);
+    SetUsbTxBufferUint32(9, stats.busTime);
+    SetUsbTxBufferUint32(13, stats.errorCount);
+    SetUsbTxBufferUint32(17, stats.pollCount);
+    // The sum rather than the mean, so that the host can average over any span between two reads.
+    SetUsbTxBufferUint64(21, stats.pollIntervalSum);
+    SetUsbTxBufferUint32(29, stats.maxPollInterval);
+    SetUsbTxBufferUint32(33, resetTime);
+    SetUsbTxBufferUint32(37, Timer_GetCurrentTimeMicros());
+    SetUsbTxBufferUint32(41, GetI2cMainBusBaudRate(slave->baudRateIdx));
+    SetUsbTxBufferUint16(45, slaveId < UHK_MODULE_MAX_SLOT_COUNT ? UhkModuleStates[slaveId].sampleAge : 0);
+}
@@ -0,0 +1,18 @@
+#ifndef __USB_COMMAND_GET_SLAVE_I2C_STATS_H__
+#define __USB_COMMAND_GET_SLAVE_I2C_STATS_H__
+
+// Macros:
+
+    #define GET_SLAVE_I2C_STATS_FLAG_RESET (1 << 0)
+
+// Functions:
+
+    void UsbCommand_GetSlaveI2cStats(void);
+
+// Typedefs:
+
+    typedef enum {
+        UsbStatusCode_GetSlaveI2cStats_InvalidSlaveId = 2,
+    } usb_status_code_get_slave_i2c_stats_t;
+
+#endif
@@ -1,11 +1,13 @@
 #include "usb_protocol_handler.h"
 #include "usb_commands/usb_command_set_i2c_baud_rate.h"
 #include "init_peripherals.h"
+#include "slave_scheduler.h"
 #include "fsl_i2c.h"
 
 void UsbCommand_SetI2cBaudRate(void)
 {
     uint32_t i2cBaudRate = GetUsbRxBufferUint32(1);
     I2cMainBusRequestedBaudRateBps = i2cBaudRate;
+    ResetSlaveBaudRates();
     ReinitI2cMainBus();
 }
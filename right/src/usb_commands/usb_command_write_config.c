@@ -23,4 +23,5 @@ void UsbCommand_WriteConfig(config_buffer_id_t configBufferId)
     }
 
     memcpy(buffer + offset, GenericHidOutBuffer + paramsSize, length);
+    ConfigBuffer_MarkChanged(buffer, offset, length);
 }
@@ -168,7 +168,8 @@ static usb_device_class_config_list_struct_t UsbDeviceCompositeConfigList = {
 }};
 
 volatile bool SleepModeActive = true;
-static volatile bool wakeUpHostAllowed;
+volatile bool WakeUpHostAllowed;
+volatile bool WakeUpHostPending;
 
 static void suspendUhk(void) {
     SleepModeActive = true;
@@ -177,18 +178,18 @@ static void suspendUhk(void) {
 
 static void wakeUpUhk(void) {
     SleepModeActive = false;
+    WakeUpHostPending = false;
     LedSlaveDriver_UpdateLeds();
 }
 
+// Doesn't wait for the host to resume, wakeUpUhk() gets called from the USB interrupt once it has.
 void WakeUpHost(void) {
-    if (!wakeUpHostAllowed) {
+    if (!WakeUpHostAllowed) {
         return;
     }
+    WakeUpHostPending = true;
     // Send resume signal - this will call USB_DeviceKhciControl(khciHandle, kUSB_DeviceControlResume, NULL);
     USB_DeviceSetStatus(UsbCompositeDevice.deviceHandle, kUSB_DeviceStatusBus, NULL);
-    while (SleepModeActive) {
-        ;
-    }
 }
 
 static usb_status_t usbDeviceCallback(usb_device_handle handle, uint32_t event, void *param)
@@ -205,6 +206,7 @@ static usb_status_t usbDeviceCallback(usb_device_handle handle, uint32_t event,
         case kUSB_DeviceEventBusReset:
             UsbCompositeDevice.attach = 0;
             MsAltEnumMode = 0;
+            WakeUpHostPending = false;
             status = kStatus_USB_Success;
             break;
         case kUSB_DeviceEventSuspend:
@@ -276,11 +278,11 @@ static usb_status_t usbDeviceCallback(usb_device_handle handle, uint32_t event,
             status = USB_DeviceGetHidPhysicalDescriptor(handle, (usb_device_get_hid_physical_descriptor_struct_t *)param);
             break;
         case kUSB_DeviceEventSetRemoteWakeup:
-            wakeUpHostAllowed = *temp8;
+            WakeUpHostAllowed = *temp8;
             status = kStatus_USB_Success;
             break;
         case kUSB_DeviceEventGetDeviceStatus:
-            if (wakeUpHostAllowed)
+            if (WakeUpHostAllowed)
                 *temp16 |= (USB_DEVICE_CONFIG_REMOTE_WAKEUP << (USB_REQUSET_STANDARD_GET_STATUS_DEVICE_REMOTE_WARKUP_SHIFT));
             status = kStatus_USB_Success;
             break;
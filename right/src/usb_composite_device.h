@@ -30,6 +30,8 @@
 // Variables:
 
     extern volatile bool SleepModeActive;
+    extern volatile bool WakeUpHostAllowed;
+    extern volatile bool WakeUpHostPending;
     extern usb_composite_device_t UsbCompositeDevice;
 
 //Functions:
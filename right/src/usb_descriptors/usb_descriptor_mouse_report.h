@@ -4,15 +4,16 @@
 // Includes:
 
     #include "usb_api.h"
+    #include "usb_interfaces/usb_interface_mouse.h"
 
 // Macros:
 
     #define USB_MOUSE_REPORT_DESCRIPTOR_LENGTH (sizeof(UsbMouseReportDescriptor))
 
-    #define USB_MOUSE_REPORT_DESCRIPTOR_MIN_AXIS_VALUE -4096
-    #define USB_MOUSE_REPORT_DESCRIPTOR_MAX_AXIS_VALUE 4096
-    #define USB_MOUSE_REPORT_DESCRIPTOR_MIN_AXIS_PHYSICAL_VALUE -4096
-    #define USB_MOUSE_REPORT_DESCRIPTOR_MAX_AXIS_PHYSICAL_VALUE 4096
+    #define USB_MOUSE_REPORT_DESCRIPTOR_MIN_AXIS_VALUE (-USB_MOUSE_MAX_AXIS_VALUE)
+    #define USB_MOUSE_REPORT_DESCRIPTOR_MAX_AXIS_VALUE USB_MOUSE_MAX_AXIS_VALUE
+    #define USB_MOUSE_REPORT_DESCRIPTOR_MIN_AXIS_PHYSICAL_VALUE (-USB_MOUSE_MAX_AXIS_VALUE)
+    #define USB_MOUSE_REPORT_DESCRIPTOR_MAX_AXIS_PHYSICAL_VALUE USB_MOUSE_MAX_AXIS_VALUE
     #define USB_MOUSE_REPORT_DESCRIPTOR_BUTTONS 8
 
     #define USB_MOUSE_REPORT_DESCRIPTOR_BUTTONS_PADDING ((USB_MOUSE_REPORT_DESCRIPTOR_BUTTONS % 8) \
@@ -57,12 +58,22 @@
 
                 HID_RI_COLLECTION(8, HID_RI_COLLECTION_LOGICAL),
 
+                    // Vertical wheel resolution multiplier
+                    HID_RI_USAGE(8, HID_RI_USAGE_GENERIC_DESKTOP_RESOLUTION_MULTIPLIER),
+                    HID_RI_LOGICAL_MINIMUM(8, 0),
+                    HID_RI_LOGICAL_MAXIMUM(8, 1),
+                    HID_RI_PHYSICAL_MINIMUM(8, 1),
+                    HID_RI_PHYSICAL_MAXIMUM(8, USB_MOUSE_WHEEL_RESOLUTION_MULTIPLIER),
+                    HID_RI_REPORT_COUNT(8, 1),
+                    HID_RI_REPORT_SIZE(8, USB_MOUSE_WHEEL_RESOLUTION_BITS),
+                    HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+
                     // Vertical wheel
                     HID_RI_USAGE(8, HID_RI_USAGE_GENERIC_DESKTOP_WHEEL),
-                    HID_RI_LOGICAL_MINIMUM(8, -127),
-                    HID_RI_LOGICAL_MAXIMUM(8, 127),
-                    HID_RI_PHYSICAL_MINIMUM(16, -127),
-                    HID_RI_PHYSICAL_MAXIMUM(16, 127),
+                    HID_RI_LOGICAL_MINIMUM(8, -USB_MOUSE_MAX_WHEEL_VALUE),
+                    HID_RI_LOGICAL_MAXIMUM(8, USB_MOUSE_MAX_WHEEL_VALUE),
+                    HID_RI_PHYSICAL_MINIMUM(16, -USB_MOUSE_MAX_WHEEL_VALUE),
+                    HID_RI_PHYSICAL_MAXIMUM(16, USB_MOUSE_MAX_WHEEL_VALUE),
                     HID_RI_REPORT_COUNT(8, 1),
                     HID_RI_REPORT_SIZE(8, 8),
                     HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
@@ -71,19 +82,34 @@
 
                 HID_RI_COLLECTION(8, HID_RI_COLLECTION_LOGICAL),
 
+                    // Horizontal wheel resolution multiplier
+                    HID_RI_USAGE(8, HID_RI_USAGE_GENERIC_DESKTOP_RESOLUTION_MULTIPLIER),
+                    HID_RI_LOGICAL_MINIMUM(8, 0),
+                    HID_RI_LOGICAL_MAXIMUM(8, 1),
+                    HID_RI_PHYSICAL_MINIMUM(8, 1),
+                    HID_RI_PHYSICAL_MAXIMUM(8, USB_MOUSE_WHEEL_RESOLUTION_MULTIPLIER),
+                    HID_RI_REPORT_COUNT(8, 1),
+                    HID_RI_REPORT_SIZE(8, USB_MOUSE_WHEEL_RESOLUTION_BITS),
+                    HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+
                     // Horizontal wheel
                     HID_RI_USAGE_PAGE(8, HID_RI_USAGE_PAGE_CONSUMER),
                     HID_RI_USAGE(16, HID_RI_USAGE_CONSUMER_AC_PAN),
-                    HID_RI_LOGICAL_MINIMUM(8, -127),
-                    HID_RI_LOGICAL_MAXIMUM(8, 127),
-                    HID_RI_PHYSICAL_MINIMUM(16, -127),
-                    HID_RI_PHYSICAL_MAXIMUM(16, 127),
+                    HID_RI_LOGICAL_MINIMUM(8, -USB_MOUSE_MAX_WHEEL_VALUE),
+                    HID_RI_LOGICAL_MAXIMUM(8, USB_MOUSE_MAX_WHEEL_VALUE),
+                    HID_RI_PHYSICAL_MINIMUM(16, -USB_MOUSE_MAX_WHEEL_VALUE),
+                    HID_RI_PHYSICAL_MAXIMUM(16, USB_MOUSE_MAX_WHEEL_VALUE),
                     HID_RI_REPORT_COUNT(8, 1),
                     HID_RI_REPORT_SIZE(8, 8),
                     HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
 
                 HID_RI_END_COLLECTION(0),
 
+                // Resolution multipliers padding
+                HID_RI_REPORT_COUNT(8, 1),
+                HID_RI_REPORT_SIZE(8, 8 - 2*USB_MOUSE_WHEEL_RESOLUTION_BITS),
+                HID_RI_FEATURE(8, HID_IOF_CONSTANT),
+
             HID_RI_END_COLLECTION(0),
         HID_RI_END_COLLECTION(0)
     };
@@ -2,6 +2,8 @@
 #include "usb_report_updater.h"
 
 static usb_mouse_report_t usbMouseReports[2];
+static usb_mouse_feature_report_t usbMouseFeatureReport;
+static uint8_t usbMouseFeatureOutBuffer[USB_MOUSE_FEATURE_REPORT_LENGTH];
 usb_hid_protocol_t usbMouseProtocol;
 uint32_t UsbMouseActionCounter;
 usb_mouse_report_t* ActiveUsbMouseReport = usbMouseReports;
@@ -26,6 +28,26 @@ usb_hid_protocol_t UsbMouseGetProtocol(void)
     return usbMouseProtocol;
 }
 
+static uint8_t getWheelMultiplier(uint8_t fieldIndex)
+{
+    if (usbMouseProtocol == USB_HID_BOOT_PROTOCOL) {
+        return 1;
+    }
+    uint8_t fieldMask = (1 << USB_MOUSE_WHEEL_RESOLUTION_BITS) - 1;
+    uint8_t field = (usbMouseFeatureReport.wheelResolutions >> (fieldIndex * USB_MOUSE_WHEEL_RESOLUTION_BITS)) & fieldMask;
+    return field ? USB_MOUSE_WHEEL_RESOLUTION_MULTIPLIER : 1;
+}
+
+uint8_t UsbMouseGetVerticalWheelMultiplier(void)
+{
+    return getWheelMultiplier(0);
+}
+
+uint8_t UsbMouseGetHorizontalWheelMultiplier(void)
+{
+    return getWheelMultiplier(1);
+}
+
 usb_status_t UsbMouseAction(void)
 {
     if (!UsbCompositeDevice.attach) {
@@ -69,6 +91,8 @@ usb_status_t UsbMouseCallback(class_handle_t handle, uint32_t event, void *param
 
     switch (event) {
         case ((uint32_t)-kUSB_DeviceEventSetConfiguration):
+            // The host has to negotiate high-resolution scrolling again after reconfiguration.
+            usbMouseFeatureReport.wheelResolutions = 0;
             error = kStatus_USB_Success;
             break;
         case ((uint32_t)-kUSB_DeviceEventSetInterface):
@@ -91,12 +115,36 @@ usb_status_t UsbMouseCallback(class_handle_t handle, uint32_t event, void *param
                 UsbMouseActionCounter++;
                 SwitchActiveUsbMouseReport();
                 error = kStatus_USB_Success;
+            } else if (report->reportType == USB_DEVICE_HID_REQUEST_GET_REPORT_TYPE_FEATURE && report->reportId == 0 && report->reportLength <= USB_MOUSE_FEATURE_REPORT_LENGTH) {
+                report->reportBuffer = (void*)&usbMouseFeatureReport;
+                error = kStatus_USB_Success;
             } else {
                 error = kStatus_USB_InvalidRequest;
             }
             break;
         }
 
+        case kUSB_DeviceHidEventSetReport: {
+            usb_device_hid_report_struct_t *report = (usb_device_hid_report_struct_t*)param;
+            if (report->reportType == USB_DEVICE_HID_REQUEST_GET_REPORT_TYPE_FEATURE && report->reportId == 0 && report->reportLength == USB_MOUSE_FEATURE_REPORT_LENGTH) {
+                usbMouseFeatureReport.wheelResolutions = report->reportBuffer[0];
+                error = kStatus_USB_Success;
+            } else {
+                error = kStatus_USB_InvalidRequest;
+            }
+            break;
+        }
+        case kUSB_DeviceHidEventRequestReportBuffer: {
+            usb_device_hid_report_struct_t *report = (usb_device_hid_report_struct_t*)param;
+            if (report->reportLength <= sizeof(usbMouseFeatureOutBuffer)) {
+                report->reportBuffer = usbMouseFeatureOutBuffer;
+                error = kStatus_USB_Success;
+            } else {
+                error = kStatus_USB_AllocFail;
+            }
+            break;
+        }
+
         case kUSB_DeviceHidEventSetProtocol: {
             uint8_t report = *(uint16_t*)param;
             if (report <= 1) {
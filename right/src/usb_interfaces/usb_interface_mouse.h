@@ -18,6 +18,15 @@
     #define USB_MOUSE_INTERRUPT_IN_INTERVAL 1
 
     #define USB_MOUSE_REPORT_LENGTH (sizeof(usb_mouse_report_t))
+    #define USB_MOUSE_FEATURE_REPORT_LENGTH (sizeof(usb_mouse_feature_report_t))
+
+    // Ranges of the relative report fields, as declared by the report descriptor.
+    #define USB_MOUSE_MAX_AXIS_VALUE 4096
+    #define USB_MOUSE_MAX_WHEEL_VALUE 127
+
+    // Wheel resolution multiplier which the host may enable through the feature report.
+    #define USB_MOUSE_WHEEL_RESOLUTION_MULTIPLIER 8
+    #define USB_MOUSE_WHEEL_RESOLUTION_BITS 2
 
 // Typedefs:
 
@@ -35,6 +44,13 @@
         int8_t wheelX;
     } ATTR_PACKED usb_mouse_report_t;
 
+    // Resolution multiplier fields of both wheels, as laid out by the report
+    // descriptor. Hosts which don't negotiate high-resolution scrolling leave
+    // them at zero, which means one count per wheel detent.
+    typedef struct {
+        uint8_t wheelResolutions;
+    } ATTR_PACKED usb_mouse_feature_report_t;
+
 // Variables:
 
     extern uint32_t UsbMouseActionCounter;
@@ -45,6 +61,8 @@
     usb_status_t UsbMouseCallback(class_handle_t handle, uint32_t event, void *param);
 
     usb_hid_protocol_t UsbMouseGetProtocol(void);
+    uint8_t UsbMouseGetVerticalWheelMultiplier(void);
+    uint8_t UsbMouseGetHorizontalWheelMultiplier(void);
     void UsbMouseResetActiveReport(void);
     usb_status_t UsbMouseAction(void);
     usb_status_t UsbMouseCheckIdleElapsed();
@@ -19,6 +19,9 @@
 #include "usb_commands/usb_command_switch_keymap.h"
 #include "usb_commands/usb_command_get_variable.h"
 #include "usb_commands/usb_command_set_variable.h"
+#include "usb_commands/usb_command_config_transfer.h"
+#include "usb_commands/usb_command_get_config_hash.h"
+#include "usb_commands/usb_command_get_slave_i2c_stats.h"
 
 void UsbProtocolHandler(void)
 {
@@ -85,6 +88,21 @@ void UsbProtocolHandler(void)
         case UsbCommandId_SetVariable:
             UsbCommand_SetVariable();
             break;
+        case UsbCommandId_StartConfigTransfer:
+            UsbCommand_StartConfigTransfer();
+            break;
+        case UsbCommandId_WriteConfigChunk:
+            UsbCommand_WriteConfigChunk();
+            break;
+        case UsbCommandId_FinishConfigTransfer:
+            UsbCommand_FinishConfigTransfer();
+            break;
+        case UsbCommandId_GetConfigHash:
+            UsbCommand_GetConfigHash();
+            break;
+        case UsbCommandId_GetSlaveI2cStats:
+            UsbCommand_GetSlaveI2cStats();
+            break;
         default:
             SetUsbTxBufferUint8(0, UsbStatusCode_InvalidCommand);
             break;
@@ -120,3 +138,9 @@ void SetUsbTxBufferUint32(uint32_t offset, uint32_t value)
 {
     SetBufferUint32(GenericHidInBuffer, offset, value);
 }
+
+void SetUsbTxBufferUint64(uint32_t offset, uint64_t value)
+{
+    SetBufferUint32(GenericHidInBuffer, offset, (uint32_t)value);
+    SetBufferUint32(GenericHidInBuffer, offset + 4, (uint32_t)(value >> 32));
+}
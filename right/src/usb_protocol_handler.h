@@ -36,6 +36,11 @@
         UsbCommandId_SwitchKeymap             = 0x11,
         UsbCommandId_GetVariable              = 0x12,
         UsbCommandId_SetVariable              = 0x13,
+        UsbCommandId_StartConfigTransfer      = 0x14,
+        UsbCommandId_WriteConfigChunk         = 0x15,
+        UsbCommandId_FinishConfigTransfer     = 0x16,
+        UsbCommandId_GetConfigHash            = 0x17,
+        UsbCommandId_GetSlaveI2cStats         = 0x18,
     } usb_command_id_t;
 
     typedef enum {
@@ -66,5 +71,6 @@
     void SetUsbTxBufferUint8(uint32_t offset, uint8_t value);
     void SetUsbTxBufferUint16(uint32_t offset, uint16_t value);
     void SetUsbTxBufferUint32(uint32_t offset, uint32_t value);
+    void SetUsbTxBufferUint64(uint32_t offset, uint64_t value);
 
 #endif
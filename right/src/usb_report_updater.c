@@ -19,6 +19,7 @@
 #include "macro_shortcut_parser.h"
 #include "postponer.h"
 #include "secondary_role_driver.h"
+#include "combos.h"
 #include "slave_drivers/touchpad_driver.h"
 #include "layer_switcher.h"
 #include "mouse_controller.h"
@@ -310,45 +311,73 @@ static void mergeReports(void)
             MacroState[j].ms.reportsUsed &= MacroState[j].ms.macroPlaying;
             macro_state_t *s = &MacroState[j];
 
-            UsbBasicKeyboard_MergeReports(&(s->ms.macroBasicKeyboardReport), ActiveUsbBasicKeyboardReport);
-            UsbMediaKeyboard_MergeReports(&(s->ms.macroMediaKeyboardReport), ActiveUsbMediaKeyboardReport);
-            UsbSystemKeyboard_MergeReports(&(s->ms.macroSystemKeyboardReport), ActiveUsbSystemKeyboardReport);
+            Macros_MergeOutput(j);
 
             InputModifiers |= s->ms.inputModifierMask;
-
-            ActiveUsbMouseReport->buttons |= s->ms.macroMouseReport.buttons;
-            ActiveUsbMouseReport->x += s->ms.macroMouseReport.x;
-            ActiveUsbMouseReport->y += s->ms.macroMouseReport.y;
-            ActiveUsbMouseReport->wheelX += s->ms.macroMouseReport.wheelX;
-            ActiveUsbMouseReport->wheelY += s->ms.macroMouseReport.wheelY;
         }
     }
 }
 
-static void commitKeyState(key_state_t *keyState, bool active)
+static void commitKeyState(key_state_t *keyState, bool active, uint32_t time)
 {
     WATCH_TRIGGER(keyState);
+    if (active && ComboCount && Combos_IsComboKey(keyState)) {
+        // Hold the keypress back until it is known whether it is a part of a combo.
+        PostponerCore_PostponeNCycles(0);
+    }
     if (PostponerCore_IsActive()) {
-        PostponerCore_TrackKeyEvent(keyState, active, 255);
+        PostponerCore_TrackKeyEventAt(keyState, active, 255, time);
     } else {
         keyState->current = active;
     }
-    WAKE_MACROS_ON_KEYSTATE_CHANGE();
+    WAKE_MACROS_ON_KEYSTATE_CHANGE(keyState);
 }
 
-static inline void preprocessKeyState(key_state_t *keyState)
+static inline void debounceKeyState(key_state_t *keyState, bool switchState, uint32_t time)
 {
     uint8_t debounceTime = keyState->previous ? DebounceTimePress : DebounceTimeRelease;
     if (keyState->debouncing && (uint8_t)(CurrentTime - keyState->timestamp) > debounceTime) {
         keyState->debouncing = false;
     }
 
-    if (!keyState->debouncing && keyState->debouncedSwitchState != keyState->hardwareSwitchState) {
+    if (!keyState->debouncing && keyState->debouncedSwitchState != switchState) {
         keyState->timestamp = CurrentTime;
         keyState->debouncing = true;
-        keyState->debouncedSwitchState = keyState->hardwareSwitchState;
+        keyState->debouncedSwitchState = switchState;
+
+        commitKeyState(keyState, switchState, time);
+    }
+}
+
+static inline void preprocessKeyState(key_state_t *keyState)
+{
+    debounceKeyState(keyState, keyState->hardwareSwitchState, CurrentTime);
+}
+
+// Applies the timestamped key events of modules in the order in which they happened, also
+// across modules. Whatever the events miss gets picked up from hardwareSwitchState afterwards.
+static void preprocessModuleKeyEvents(void)
+{
+    uhk_module_key_event_t events[UHK_MODULE_KEY_EVENT_QUEUE_SIZE];
+    uint8_t eventCount = UhkModuleSlaveDriver_TakeKeyEvents(events, UHK_MODULE_KEY_EVENT_QUEUE_SIZE);
+
+    for (uint8_t i = 1; i < eventCount; i++) {
+        uhk_module_key_event_t event = events[i];
+        uint8_t j = i;
+        while (j > 0 && (int32_t)(events[j-1].timeMicros - event.timeMicros) > 0) {
+            events[j] = events[j-1];
+            j--;
+        }
+        events[j] = event;
+    }
+
+    if (eventCount > 1) {
+        // Otherwise the events would all take effect at once within this cycle.
+        PostponerCore_PostponeNCycles(0);
+    }
 
-        commitKeyState(keyState, keyState->debouncedSwitchState);
+    for (uint8_t i = 0; i < eventCount; i++) {
+        debounceKeyState(events[i].keyState, events[i].active, events[i].time);
     }
 }
 
@@ -390,14 +419,8 @@ static void handleLayerChanges() {
     }
 }
 
-static void updateActiveUsbReports(void)
+static void continueMacros(void)
 {
-    clearActiveReports();
-    InputModifiersPrevious = InputModifiers;
-    InputModifiers = 0;
-    OutputModifiers = 0;
-    SuppressMods = false;
-
     if (MacroPlaying) {
         if (Macros_WakeMeOnTime < CurrentTime) {
             Macros_WakedBecauseOfTime = true;
@@ -405,6 +428,17 @@ static void updateActiveUsbReports(void)
         }
         Macros_ContinueMacro();
     }
+}
+
+static void updateActiveUsbReports(void)
+{
+    clearActiveReports();
+    InputModifiersPrevious = InputModifiers;
+    InputModifiers = 0;
+    OutputModifiers = 0;
+    SuppressMods = false;
+
+    continueMacros();
 
     memcpy(ActiveMouseStates, ToggledMouseStates, ACTIVE_MOUSE_STATES_COUNT);
 
@@ -416,6 +450,8 @@ static void updateActiveUsbReports(void)
 
     handleUsbStackTestMode();
 
+    preprocessModuleKeyEvents();
+
     if (PostponerCore_IsActive()) {
         PostponerCore_RunPostponedEvents();
     }
@@ -470,12 +506,16 @@ static void updateActiveUsbReports(void)
         }
     }
 
+    Combos_ApplyActions();
+
     MouseController_ProcessMouseActions();
 
     PostponerCore_FinishCycle();
 
     mergeReports();
 
+    MouseController_FillReportMotion(ActiveUsbMouseReport);
+
     // When a layer switcher key gets pressed along with another key that produces some modifiers
     // and the accomanying key gets released then keep the related modifiers active a long as the
     // layer switcher key stays pressed.  Useful for Alt+Tab keymappings and the like.
@@ -489,6 +529,7 @@ void justPreprocessInput(void) {
     // Make preprocessKeyState push new events into postponer queue.
     // As a side-effect, postpone first cycle after we switch back to regular update loop
     PostponerCore_PostponeNCycles(0);
+    preprocessModuleKeyEvents();
     for (uint8_t slotId=0; slotId<SLOT_COUNT; slotId++) {
         for (uint8_t keyId=0; keyId<MAX_KEY_COUNT_PER_MODULE; keyId++) {
             key_state_t *keyState = &KeyStates[slotId][keyId];
@@ -499,6 +540,54 @@ void justPreprocessInput(void) {
 }
 
 uint32_t UsbReportUpdateCounter;
+uint32_t WakeUpPreservedEventCount;
+
+// Keeps macros, their timers and the mouse controller running while key events are buffered. Their
+// output can't reach the suspended host, so it's dropped, including the pointer motion which would
+// otherwise come out as a single jump after the resume.
+static void discardActiveUsbReports(void)
+{
+    clearActiveReports();
+    continueMacros();
+    memcpy(ActiveMouseStates, ToggledMouseStates, ACTIVE_MOUSE_STATES_COUNT);
+    MouseController_ProcessMouseActions();
+    mergeReports();
+    memset(&PendingMouseMotion, 0, sizeof PendingMouseMotion);
+    clearActiveReports();
+}
+
+// While the host is suspended, key events are kept in the postponer queue instead of being turned
+// into reports which would get lost. The first keypress asks the host to resume, and the queue gets
+// replayed in order once it has. If the host doesn't resume in WAKE_UP_HOST_TIMEOUT, the events are
+// processed as usual.
+static bool bufferInputWhileHostSleeps(void)
+{
+    static uint32_t wakeUpRequestTime;
+    static bool isBuffering;
+
+    if (!SleepModeActive) {
+        if (isBuffering) {
+            WakeUpPreservedEventCount += PostponerQuery_PendingEventCount();
+            isBuffering = false;
+        }
+        return false;
+    }
+
+    if (!WakeUpHostAllowed || (WakeUpHostPending && Timer_GetElapsedTime(&wakeUpRequestTime) > WAKE_UP_HOST_TIMEOUT)) {
+        isBuffering = false;
+        return false;
+    }
+
+    justPreprocessInput();
+    discardActiveUsbReports();
+    isBuffering = true;
+
+    if (!WakeUpHostPending && PostponerQuery_PendingKeypressCount() > 0) {
+        wakeUpRequestTime = CurrentTime;
+        WakeUpHost();
+    }
+    return true;
+}
 
 static void updateLedSleepModeState(uint32_t lastActivityTime) {
     uint32_t elapsedTime = Timer_GetElapsedTime(&lastActivityTime);
@@ -522,6 +611,10 @@ void UpdateUsbReports(void)
         KeyStates[SlotId_RightKeyboardHalf][keyId].hardwareSwitchState = RightKeyMatrix.keyStates[keyId];
     }
 
+    if (bufferInputWhileHostSleeps()) {
+        return;
+    }
+
     if (UsbReportUpdateSemaphore && !SleepModeActive) {
         if (Timer_GetElapsedTime(&lastUpdateTime) < USB_SEMAPHORE_TIMEOUT) {
             return;
@@ -586,9 +679,13 @@ void UpdateUsbReports(void)
     }
 
     if (UsbMouseCheckReportReady() == kStatus_USB_Success) {
+        usb_mouse_report_t *mouseReport = ActiveUsbMouseReport;
         UsbReportUpdateSemaphore |= 1 << USB_MOUSE_INTERFACE_INDEX;
         usb_status_t status = UsbMouseAction();
-        if (status != kStatus_USB_Success) {
+        if (status == kStatus_USB_Success) {
+            // Whatever didn't fit into the report is carried over into the next one.
+            MouseController_ConsumeReportMotion(mouseReport);
+        } else {
             UsbReportUpdateSemaphore &= ~(1 << USB_MOUSE_INTERFACE_INDEX);
         }
         lastActivityTime = CurrentTime;
@@ -12,12 +12,14 @@
 // Macros:
 
     #define USB_SEMAPHORE_TIMEOUT 100 // ms
+    #define WAKE_UP_HOST_TIMEOUT 3000 // ms
 
 // Typedefs:
 
 // Variables:
 
     extern uint32_t UsbReportUpdateCounter;
+    extern uint32_t WakeUpPreservedEventCount;
     extern volatile uint8_t UsbReportUpdateSemaphore;
     extern bool TestUsbStack;
     extern uint8_t InputModifiers;
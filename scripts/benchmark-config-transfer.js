@@ -0,0 +1,165 @@
+#!/usr/bin/env node
+// Compares the legacy stop-and-wait config upload with the windowed, optionally compressed
+// config transfer of right/src/usb_commands/usb_command_config_transfer.c, which
+// config-transfer-model/Makefile compiles for the host and runs against a simulated generic HID
+// endpoint.
+//
+// Usage: ./benchmark-config-transfer.js [userConfig.bin] [--window N] [--latency MS] [--loss RATIO]
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const childProcess = require('child_process');
+
+const PACKET_SIZE = 64;
+const CHUNK_PAYLOAD_SIZE = PACKET_SIZE - 4; // command id, length, uint16 offset
+const FRAME_MS = 1; // interrupt endpoint polling interval
+const USER_CONFIG_SIZE = 32 * 1024 - 64;
+
+const MATCH_FLAG = 0x80;
+const LENGTH_MASK = 0x7f;
+const MIN_MATCH_LENGTH = 3;
+const MAX_MATCH_LENGTH = LENGTH_MASK + MIN_MATCH_LENGTH;
+const MAX_LITERAL_LENGTH = LENGTH_MASK + 1;
+const MAX_DISTANCE = 0xffff;
+
+const StatusCode = {
+    Success: 0,
+    UnexpectedOffset: 6,
+    InvalidStream: 7,
+    Incomplete: 8,
+    CrcMismatch: 9,
+};
+
+function getArg(name, defaultValue) {
+    const index = process.argv.indexOf(name);
+    return index === -1 ? defaultValue : Number(process.argv[index + 1]);
+}
+
+function crc16(data) {
+    let crc = 0;
+    for (const byte of data) {
+        crc ^= byte << 8;
+        for (let i = 0; i < 8; i++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+            crc &= 0xffff;
+        }
+    }
+    return crc;
+}
+
+// Greedy LZ77 matching the token format of the firmware decoder.
+function compress(data) {
+    const output = [];
+    const lastPositions = new Map();
+    let literals = [];
+
+    const flushLiterals = () => {
+        while (literals.length) {
+            const run = literals.splice(0, MAX_LITERAL_LENGTH);
+            output.push(run.length - 1, ...run);
+        }
+    };
+
+    let pos = 0;
+    while (pos < data.length) {
+        let matchLength = 0;
+        let matchDistance = 0;
+        if (pos + MIN_MATCH_LENGTH <= data.length) {
+            const key = data[pos] | data[pos + 1] << 8 | data[pos + 2] << 16;
+            for (const candidate of lastPositions.get(key) || []) {
+                if (pos - candidate > MAX_DISTANCE) {
+                    continue;
+                }
+                let length = 0;
+                while (length < MAX_MATCH_LENGTH && pos + length < data.length && data[candidate + length] === data[pos + length]) {
+                    length++;
+                }
+                if (length > matchLength) {
+                    matchLength = length;
+                    matchDistance = pos - candidate;
+                }
+            }
+            const positions = lastPositions.get(key) || [];
+            positions.unshift(pos);
+            positions.length = Math.min(positions.length, 16);
+            lastPositions.set(key, positions);
+        }
+
+        if (matchLength >= MIN_MATCH_LENGTH) {
+            flushLiterals();
+            output.push(MATCH_FLAG | (matchLength - MIN_MATCH_LENGTH), matchDistance & 0xff, matchDistance >> 8);
+            pos += matchLength;
+        } else {
+            literals.push(data[pos++]);
+        }
+    }
+    flushLiterals();
+    return Buffer.from(output);
+}
+
+// Legacy protocol: every chunk waits for its response before the next one is sent.
+function simulateStopAndWait(data, latencyMs) {
+    const chunkCount = Math.ceil(data.length / CHUNK_PAYLOAD_SIZE);
+    return chunkCount * (2 * FRAME_MS + latencyMs);
+}
+
+// Windowed protocol, run by the firmware command compiled for the host.
+function simulateWindowed(config, stream, crc, isCompressed, window, latencyMs, lossRatio) {
+    const tempDir = fs.mkdtempSync(path.join(os.tmpdir(), 'config-transfer-'));
+    try {
+        const configPath = path.join(tempDir, 'config.bin');
+        const streamPath = path.join(tempDir, 'stream.bin');
+        fs.writeFileSync(configPath, config);
+        fs.writeFileSync(streamPath, stream);
+        const modelArgs = [configPath, streamPath, '--crc', crc, '--window', window, '--latency', latencyMs, '--loss', lossRatio];
+        if (isCompressed) {
+            modelArgs.push('--compressed');
+        }
+        const output = childProcess.execFileSync(path.join(modelDir, 'build', 'config-transfer-model'), modelArgs.map(String));
+        return JSON.parse(output);
+    } finally {
+        fs.rmSync(tempDir, {recursive: true});
+    }
+}
+
+function syntheticConfig() {
+    // Keymaps of a real configuration are largely alike, which the synthetic one mimics.
+    const keymap = Buffer.from(Array.from({length: 1500}, (_, i) => (i * 7) % 23 === 0 ? i & 0xff : (i % 5) + 1));
+    const parts = [Buffer.from([5, 0, 1, 0, 0, 0])];
+    for (let i = 0; i < 12; i++) {
+        const variant = Buffer.from(keymap);
+        variant[i * 31] ^= 0x55;
+        parts.push(variant);
+    }
+    return Buffer.concat(parts).subarray(0, USER_CONFIG_SIZE);
+}
+
+const configPath = process.argv[2] && !process.argv[2].startsWith('--') ? process.argv[2] : null;
+const config = configPath ? fs.readFileSync(configPath) : syntheticConfig();
+const window = getArg('--window', 8);
+const latencyMs = getArg('--latency', 2);
+const lossRatio = getArg('--loss', 0);
+const crc = crc16(config);
+
+console.log(`Config: ${configPath || 'synthetic'}, ${config.length} bytes, CRC16 0x${crc.toString(16)}`);
+console.log(`Window: ${window} chunks, host latency: ${latencyMs} ms, packet loss: ${lossRatio}`);
+console.log(`stop-and-wait:          ${simulateStopAndWait(config, latencyMs)} ms`);
+
+const modelDir = path.join(__dirname, 'config-transfer-model');
+childProcess.execFileSync('make', ['-s', '-C', modelDir], {stdio: 'inherit'});
+
+for (const isCompressed of [false, true]) {
+    const stream = isCompressed ? compress(config) : config;
+    const result = simulateWindowed(config, stream, crc, isCompressed, window, latencyMs, lossRatio);
+    if (result.status !== StatusCode.Success) {
+        console.error(`Transfer failed with status ${result.status}`);
+        process.exit(1);
+    }
+    if (result.crc !== crc || !result.isMatching) {
+        console.error('The staging buffer differs from the config');
+        process.exit(1);
+    }
+    const label = isCompressed ? `windowed, compressed:` : `windowed:            `;
+    console.log(`${label}   ${result.time} ms, ${result.streamLength} bytes in ${result.packetCount} packets, ${result.resendCount} resends`);
+}
@@ -0,0 +1,238 @@
+// Runs the windowed config transfer of usb_command_config_transfer.c against a simulated generic HID
+// endpoint, in simulated time. The host sends one OUT packet per frame while fewer than `window`
+// chunks are unacknowledged, and every response arrives one frame plus the host latency after its
+// chunk. A chunk may get lost on the way to the device, upon which the host goes back to the offset
+// which the device reports.
+//
+// Usage: config-transfer-model <config file> <stream file> --crc CRC [--compressed] [--window N] [--latency MS] [--loss RATIO]
+//
+// The stream file is the config file as sent by the host, so compressed when --compressed is given.
+// Prints the outcome of the transfer and whether the staging buffer ended up holding the config as JSON.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fsl_common.h"
+#include "buffer.h"
+#include "eeprom.h"
+#include "usb_protocol_handler.h"
+#include "usb_commands/usb_command_config_transfer.h"
+#include "config_parser/config_globals.h"
+
+#define FRAME_MS 1
+#define MAX_WINDOW 64
+#define CHUNK_PARAMS_SIZE (USB_STATUS_CODE_SIZE + 1 + 2)
+#define CHUNK_PAYLOAD_SIZE (USB_GENERIC_HID_OUT_BUFFER_LENGTH - CHUNK_PARAMS_SIZE)
+#define RESEND_TIMEOUT_MS (10 * FRAME_MS)
+
+typedef struct {
+    uint32_t time;
+    uint8_t status;
+    uint16_t offset;
+} ack_t;
+
+uint8_t GenericHidInBuffer[USB_GENERIC_HID_IN_BUFFER_LENGTH];
+uint8_t GenericHidOutBuffer[USB_GENERIC_HID_OUT_BUFFER_LENGTH];
+
+static ack_t acks[MAX_WINDOW];
+static uint8_t ackHead;
+static uint8_t ackCount;
+static uint32_t randomSeed = 1;
+
+// The accessors of usb_protocol_handler.c, which dispatches to every other command too.
+uint8_t GetUsbRxBufferUint8(uint32_t offset)
+{
+    return GetBufferUint8(GenericHidOutBuffer, offset);
+}
+
+uint16_t GetUsbRxBufferUint16(uint32_t offset)
+{
+    return GetBufferUint16(GenericHidOutBuffer, offset);
+}
+
+void SetUsbTxBufferUint8(uint32_t offset, uint8_t value)
+{
+    SetBufferUint8(GenericHidInBuffer, offset, value);
+}
+
+void SetUsbTxBufferUint16(uint32_t offset, uint16_t value)
+{
+    SetBufferUint16(GenericHidInBuffer, offset, value);
+}
+
+bool EEPROM_GetPageHash(uint16_t pageIdx, uint64_t *hash)
+{
+    return false;
+}
+
+static void runCommand(usb_command_id_t commandId, void (*command)(void))
+{
+    GenericHidOutBuffer[0] = commandId;
+    bzero(GenericHidInBuffer, USB_GENERIC_HID_IN_BUFFER_LENGTH);
+    command();
+}
+
+// Seeded so that lossy runs are reproducible.
+static double getRandom(void)
+{
+    randomSeed = (randomSeed * 1103515245 + 12345) & 0x7fffffff;
+    return (double)randomSeed / 0x7fffffff;
+}
+
+static void pushAck(uint32_t time)
+{
+    acks[(ackHead + ackCount++) % MAX_WINDOW] = (ack_t) {
+        .time = time,
+        .status = GetBufferUint8(GenericHidInBuffer, 0),
+        .offset = GetBufferUint16(GenericHidInBuffer, 1),
+    };
+}
+
+static ack_t popAck(void)
+{
+    ack_t ack = acks[ackHead];
+    ackHead = (ackHead + 1) % MAX_WINDOW;
+    ackCount--;
+    return ack;
+}
+
+static uint8_t *readFile(const char *path, uint32_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        exit(2);
+    }
+    fseek(file, 0, SEEK_END);
+    *length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc(*length ? *length : 1);
+    if (fread(data, 1, *length, file) != *length) {
+        perror(path);
+        exit(2);
+    }
+    fclose(file);
+    return data;
+}
+
+static uint32_t getArg(int argc, char **argv, const char *name, uint32_t defaultValue)
+{
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return strtoul(argv[i + 1], NULL, 0);
+        }
+    }
+    return defaultValue;
+}
+
+static double getRatioArg(int argc, char **argv, const char *name, double defaultValue)
+{
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return strtod(argv[i + 1], NULL);
+        }
+    }
+    return defaultValue;
+}
+
+static bool hasArg(int argc, char **argv, const char *name)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <config file> <stream file> --crc CRC [--compressed] [--window N] [--latency MS] [--loss RATIO]\n", argv[0]);
+        return 2;
+    }
+
+    uint32_t configLength, streamLength;
+    uint8_t *config = readFile(argv[1], &configLength);
+    uint8_t *stream = readFile(argv[2], &streamLength);
+    uint16_t crc = getArg(argc, argv, "--crc", 0);
+    bool isCompressed = hasArg(argc, argv, "--compressed");
+    uint32_t window = getArg(argc, argv, "--window", 8);
+    uint32_t latencyMs = getArg(argc, argv, "--latency", 2);
+    double lossRatio = getRatioArg(argc, argv, "--loss", 0);
+    window = window < 1 ? 1 : window > MAX_WINDOW ? MAX_WINDOW : window;
+
+    GenericHidOutBuffer[1] = ConfigBufferId_StagingUserConfig;
+    GenericHidOutBuffer[2] = isCompressed ? CONFIG_TRANSFER_FLAG_COMPRESSED : 0;
+    SetBufferUint16(GenericHidOutBuffer, 3, configLength);
+    SetBufferUint16(GenericHidOutBuffer, 5, crc);
+    runCommand(UsbCommandId_StartConfigTransfer, UsbCommand_StartConfigTransfer);
+    uint8_t status = GetBufferUint8(GenericHidInBuffer, 0);
+
+    uint32_t time = 0;
+    uint32_t sendOffset = 0;
+    uint32_t ackedOffset = 0;
+    uint32_t packetCount = 0;
+    uint32_t resendCount = 0;
+
+    while (status == UsbStatusCode_Success && ackedOffset < streamLength) {
+        while (ackCount && acks[ackHead].time <= time) {
+            ack_t ack = popAck();
+            if (ack.status == UsbStatusCode_ConfigTransfer_UnexpectedOffset) {
+                // Go back to the first chunk which the device hasn't got.
+                sendOffset = ack.offset;
+                ackCount = 0;
+                resendCount++;
+            } else if (ack.status != UsbStatusCode_Success) {
+                status = ack.status;
+                break;
+            }
+            ackedOffset = ack.offset > ackedOffset ? ack.offset : ackedOffset;
+        }
+
+        uint32_t inFlight = (sendOffset - ackedOffset + CHUNK_PAYLOAD_SIZE - 1) / CHUNK_PAYLOAD_SIZE;
+        if (sendOffset < streamLength && inFlight < window) {
+            uint8_t length = streamLength - sendOffset < CHUNK_PAYLOAD_SIZE ? streamLength - sendOffset : CHUNK_PAYLOAD_SIZE;
+            packetCount++;
+            if (getRandom() >= lossRatio) {
+                GenericHidOutBuffer[1] = length;
+                SetBufferUint16(GenericHidOutBuffer, 2, sendOffset);
+                memcpy(GenericHidOutBuffer + CHUNK_PARAMS_SIZE, stream + sendOffset, length);
+                runCommand(UsbCommandId_WriteConfigChunk, UsbCommand_WriteConfigChunk);
+                pushAck(time + FRAME_MS + latencyMs);
+            }
+            sendOffset += length;
+        } else if (!ackCount && sendOffset >= streamLength && ackedOffset < streamLength) {
+            // The tail got lost; resend it after a timeout.
+            time += RESEND_TIMEOUT_MS;
+            sendOffset = ackedOffset;
+            resendCount++;
+            continue;
+        }
+        time += FRAME_MS;
+    }
+
+    uint16_t deviceCrc = 0;
+    if (status == UsbStatusCode_Success) {
+        runCommand(UsbCommandId_FinishConfigTransfer, UsbCommand_FinishConfigTransfer);
+        status = GetBufferUint8(GenericHidInBuffer, 0);
+        deviceCrc = GetBufferUint16(GenericHidInBuffer, 1);
+        time += FRAME_MS + latencyMs;
+    }
+
+    bool isMatching = configLength <= USER_CONFIG_SIZE && memcmp(StagingUserConfigBuffer.buffer, config, configLength) == 0;
+
+    printf("{\n");
+    printf("  \"status\": %u,\n", status);
+    printf("  \"crc\": %u,\n", deviceCrc);
+    printf("  \"isMatching\": %s,\n", isMatching ? "true" : "false");
+    printf("  \"time\": %u,\n", time);
+    printf("  \"streamLength\": %u,\n", streamLength);
+    printf("  \"packetCount\": %u,\n", packetCount);
+    printf("  \"resendCount\": %u\n", resendCount);
+    printf("}\n");
+
+    free(config);
+    free(stream);
+    return 0;
+}
@@ -0,0 +1,602 @@
+// Runs the slave scheduler and the slave drivers of the right half against the module firmware
+// and behavioral models of the other main bus peripherals, in simulated time. The transfers which
+// the drivers start through i2c.c complete after their duration at the current baud rate, when the
+// scheduler gets called back like from the I2C interrupt.
+//
+// Usage: bus-model [--baud BPS] [--duration MS] [--overhead-us US] [--touchpad] < workload
+//
+// Every workload line is "<time in ms> <event> <target> <argument>", sorted by time:
+// - keydown, keyup: changes the switch state of the given key of "leftHalf", "leftModule" or "rightModule"
+// - leds: changes the first `argument` values of "rightLeds", "leftLeds" or "moduleLeds"
+// - brightness: makes the master send the given LED brightness to a module
+//
+// Prints the slave stats of the scheduler, the module key latencies and the state of the LED
+// driver registers as JSON.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "fsl_common.h"
+#include "fsl_i2c.h"
+#include "bus_model.h"
+#include "i2c.h"
+#include "i2c_addresses.h"
+#include "init_peripherals.h"
+#include "key_states.h"
+#include "slave_scheduler.h"
+#include "slave_drivers/is31fl3xxx_driver.h"
+#include "slave_drivers/uhk_module_driver.h"
+#include "module_model.h"
+
+#define MAX_WORKLOAD_ITEM_COUNT 100000
+#define MAX_EVENT_NAME_LENGTH 16
+#define IQS5XX_REPORT_INTERVAL_USEC 1000
+#define LED_DRIVER_PAGE_COUNT 16
+#define LED_DRIVER_PAGE_SIZE 256
+#define BUS_IDLE_BYTE 0xff
+
+typedef enum {
+    WorkloadEvent_KeyDown,
+    WorkloadEvent_KeyUp,
+    WorkloadEvent_Leds,
+    WorkloadEvent_Brightness,
+} workload_event_t;
+
+typedef struct {
+    uint64_t time;
+    workload_event_t event;
+    uint8_t targetId;
+    uint16_t argument;
+} workload_item_t;
+
+typedef struct {
+    const char *name;
+    module_model_t *model;
+    uint8_t driverId;
+    uint64_t changeTimes[MAX_KEY_COUNT_PER_MODULE][2]; // Indexed by the new state of the key
+    bool expectedStates[MAX_KEY_COUNT_PER_MODULE];
+    bool isLatencyPending[MAX_KEY_COUNT_PER_MODULE];
+    uint32_t keyChangeCount;
+    uint32_t latencyCount;
+    uint64_t latencySum;
+    uint32_t maxLatency;
+    uint32_t keyEventCount;
+    uint64_t timestampErrorSum;
+    uint32_t maxTimestampError;
+} module_t;
+
+typedef struct {
+    const char *name;
+    led_driver_ic_t ic;
+    uint8_t i2cAddress;
+    uint8_t ledCount;
+    uint8_t pages[LED_DRIVER_PAGE_COUNT][LED_DRIVER_PAGE_SIZE];
+    uint8_t page;
+    bool isUnlocked;
+    uint8_t latchedValues[LED_DRIVER_LED_COUNT_IS31FL3199];
+    uint32_t lockedPageSwitchCount;
+} led_driver_t;
+
+typedef struct {
+    bool isPresent;
+    bool isWindowOpen;
+    uint64_t windowClosedTime;
+} touchpad_t;
+
+typedef struct {
+    status_t status;
+    uint16_t byteCount;
+    uint8_t conditionCount; // Start, repeated start and stop conditions
+} transfer_result_t;
+
+static const char *slaveNames[SLAVE_COUNT] = {
+    "leftHalf", "leftModule", "rightModule", "touchpad", "rightLeds", "leftLeds", "moduleLeds", "kboot",
+};
+
+static module_t modules[] = {
+    {.name = "leftHalf", .model = &LeftHalfModel, .driverId = UhkModuleDriverId_LeftKeyboardHalf},
+    {.name = "leftModule", .model = &KeyClusterModel, .driverId = UhkModuleDriverId_LeftModule},
+    {.name = "rightModule", .model = &TrackballModel, .driverId = UhkModuleDriverId_RightModule},
+};
+
+// Indexed by led_driver_id_t
+static led_driver_t ledDrivers[] = {
+#if DEVICE_ID == DEVICE_ID_UHK60V1
+    {.name = "rightLeds", .ic = LedDriverIc_IS31FL3731, .i2cAddress = I2C_ADDRESS_IS31FL3731_RIGHT, .ledCount = LED_DRIVER_LED_COUNT_IS31FL3731},
+    {.name = "leftLeds", .ic = LedDriverIc_IS31FL3731, .i2cAddress = I2C_ADDRESS_IS31FL3731_LEFT, .ledCount = LED_DRIVER_LED_COUNT_IS31FL3731},
+#else
+    {.name = "rightLeds", .ic = LedDriverIc_IS31FL3737, .i2cAddress = I2C_ADDRESS_IS31FL3737_RIGHT, .ledCount = LED_DRIVER_LED_COUNT_IS31FL3737},
+    {.name = "leftLeds", .ic = LedDriverIc_IS31FL3737, .i2cAddress = I2C_ADDRESS_IS31FL3737_LEFT, .ledCount = LED_DRIVER_LED_COUNT_IS31FL3737},
+#endif
+    {.name = "moduleLeds", .ic = LedDriverIc_IS31FL3199, .i2cAddress = I2C_ADDRESS_IS31FL3199_MODULE_LEFT, .ledCount = LED_DRIVER_LED_COUNT_IS31FL3199},
+};
+
+static touchpad_t touchpad;
+
+static workload_item_t workload[MAX_WORKLOAD_ITEM_COUNT];
+static uint32_t workloadLength;
+static uint32_t workloadPos;
+
+static uint32_t overheadMicros = 15;
+
+static i2c_master_handle_t *masterHandle;
+static bool isTransferPending;
+static uint64_t transferEndTime;
+static status_t transferStatus;
+static bool isClosingTouchpadWindow;
+
+// LED driver ICs
+
+static const char *getLedDriverIcName(led_driver_ic_t ic)
+{
+    switch (ic) {
+        case LedDriverIc_IS31FL3199:
+            return "IS31FL3199";
+        case LedDriverIc_IS31FL3731:
+            return "IS31FL3731";
+        default:
+            return "IS31FL3737";
+    }
+}
+
+// The register file is paged behind 0xFD on the IS31FL3731/3737, where the IS31FL3737 also requires
+// unlocking by 0xFE before every page switch. The IS31FL3199 latches its PWM registers on a write to 0x10.
+static void writeLedDriver(led_driver_t *ledDriver, const uint8_t *data, size_t length)
+{
+    if (length < 2) {
+        return;
+    }
+    uint8_t reg = data[0];
+    const uint8_t *values = data + 1;
+    size_t valueCount = length - 1;
+
+    if (ledDriver->ic != LedDriverIc_IS31FL3199 && reg == LED_DRIVER_REGISTER_WRITE_LOCK) {
+        ledDriver->isUnlocked = values[0] == LED_DRIVER_WRITE_LOCK_ENABLE_ONCE;
+        return;
+    }
+    if (ledDriver->ic != LedDriverIc_IS31FL3199 && reg == LED_DRIVER_REGISTER_FRAME) {
+        if (ledDriver->ic == LedDriverIc_IS31FL3737 && !ledDriver->isUnlocked) {
+            ledDriver->lockedPageSwitchCount++;
+            return;
+        }
+        ledDriver->page = values[0] % LED_DRIVER_PAGE_COUNT;
+        ledDriver->isUnlocked = false;
+        return;
+    }
+
+    memcpy(ledDriver->pages[ledDriver->page] + reg, values, MIN(valueCount, (size_t)(LED_DRIVER_PAGE_SIZE - reg)));
+    if (ledDriver->ic == LedDriverIc_IS31FL3199 && reg == 0x10) {
+        memcpy(ledDriver->latchedValues, ledDriver->pages[0] + FRAME_REGISTER_PWM_FIRST_IS31FL3199, LED_DRIVER_LED_COUNT_IS31FL3199);
+    }
+}
+
+static const uint8_t *getLedDriverPwmValues(led_driver_t *ledDriver)
+{
+    switch (ledDriver->ic) {
+        case LedDriverIc_IS31FL3199:
+            return ledDriver->latchedValues;
+        case LedDriverIc_IS31FL3731:
+            return ledDriver->pages[LED_DRIVER_FRAME_1] + FRAME_REGISTER_PWM_FIRST_IS31FL3731;
+        default:
+            return ledDriver->pages[LED_DRIVER_FRAME_2] + FRAME_REGISTER_PWM_FIRST_IS31FL3737;
+    }
+}
+
+// Main bus
+
+static module_t *findModule(uint8_t i2cAddress)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(modules); i++) {
+        if (modules[i].model->i2cAddress == i2cAddress) {
+            return modules + i;
+        }
+    }
+    return NULL;
+}
+
+static led_driver_t *findLedDriver(uint8_t i2cAddress)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(ledDrivers); i++) {
+        if (ledDrivers[i].i2cAddress == i2cAddress) {
+            return ledDrivers + i;
+        }
+    }
+    return NULL;
+}
+
+// Reads the response of a module. Message reads end after the length announced in the header,
+// other reads clock out the idle bus past the end of the response.
+static uint16_t readModule(module_t *module, i2c_master_transfer_t *xfer, bool isMessageRead)
+{
+    uint8_t response[I2C_MESSAGE_MAX_TOTAL_LENGTH];
+    size_t responseLength = module->model->read(response, sizeof(response));
+    size_t readLength = xfer->dataSize;
+    if (isMessageRead) {
+        uint8_t payloadLength = responseLength ? response[0] : BUS_IDLE_BYTE;
+        readLength = MIN(I2C_MESSAGE_HEADER_LENGTH + payloadLength, xfer->dataSize);
+    }
+    memset(xfer->data, BUS_IDLE_BYTE, readLength);
+    memcpy(xfer->data, response, MIN(responseLength, readLength));
+    return readLength;
+}
+
+static transfer_result_t transferToModule(module_t *module, i2c_master_transfer_t *xfer, bool isMessageRead)
+{
+    transfer_result_t result = {.status = kStatus_Success, .byteCount = 1, .conditionCount = 2};
+
+    if (xfer->subaddressSize) {
+        uint8_t subaddress[I2C_MAX_SUBADDRESS_SIZE];
+        for (uint8_t i = 0; i < xfer->subaddressSize; i++) {
+            subaddress[i] = xfer->subaddress >> 8 * (xfer->subaddressSize - 1 - i);
+        }
+        module->model->write(subaddress, xfer->subaddressSize);
+        result.byteCount += 1 + xfer->subaddressSize;
+        result.conditionCount++;
+    }
+
+    if (xfer->direction == kI2C_Write) {
+        module->model->write(xfer->data, xfer->dataSize);
+        result.byteCount += xfer->dataSize;
+    } else {
+        result.byteCount += readModule(module, xfer, isMessageRead);
+    }
+    module->model->stop();
+
+    return result;
+}
+
+static transfer_result_t transferToLedDriver(led_driver_t *ledDriver, i2c_master_transfer_t *xfer)
+{
+    transfer_result_t result = {.status = kStatus_Success, .byteCount = 1 + xfer->dataSize, .conditionCount = 2};
+    if (xfer->direction == kI2C_Write) {
+        writeLedDriver(ledDriver, xfer->data, xfer->dataSize);
+    } else {
+        memset(xfer->data, 0, xfer->dataSize);
+    }
+    return result;
+}
+
+// The IQS5xx NACKs when a communication window is opened sooner than its report interval after
+// the previous one got closed.
+static transfer_result_t transferToTouchpad(i2c_master_transfer_t *xfer)
+{
+    static const uint8_t closeCommunicationWindow[] = {0xee, 0xee, 0xee};
+
+    bool isReportDue = ModelTimeMicros - touchpad.windowClosedTime >= IQS5XX_REPORT_INTERVAL_USEC;
+    if (!touchpad.isWindowOpen && !isReportDue) {
+        return (transfer_result_t){.status = kStatus_I2C_Nak, .byteCount = 1, .conditionCount = 2};
+    }
+
+    touchpad.isWindowOpen = true;
+    if (xfer->direction == kI2C_Write) {
+        isClosingTouchpadWindow = xfer->dataSize == sizeof(closeCommunicationWindow) &&
+            memcmp(xfer->data, closeCommunicationWindow, sizeof(closeCommunicationWindow)) == 0;
+    } else {
+        memset(xfer->data, 0, xfer->dataSize);
+    }
+    return (transfer_result_t){.status = kStatus_Success, .byteCount = 1 + xfer->dataSize, .conditionCount = 2};
+}
+
+static transfer_result_t transfer(i2c_master_transfer_t *xfer, bool isMessageRead)
+{
+    module_t *module = findModule(xfer->slaveAddress);
+    if (module) {
+        return transferToModule(module, xfer, isMessageRead);
+    }
+
+    led_driver_t *ledDriver = findLedDriver(xfer->slaveAddress);
+    if (ledDriver) {
+        return transferToLedDriver(ledDriver, xfer);
+    }
+
+    if (touchpad.isPresent && xfer->slaveAddress == I2C_ADDRESS_RIGHT_IQS5XX_FIRMWARE) {
+        return transferToTouchpad(xfer);
+    }
+
+    return (transfer_result_t){.status = kStatus_I2C_Nak, .byteCount = 1, .conditionCount = 2};
+}
+
+void I2C_MasterTransferCreateHandle(I2C_Type *base, i2c_master_handle_t *handle, i2c_master_transfer_callback_t callback, void *userData)
+{
+    handle->completionCallback = callback;
+    handle->userData = userData;
+    masterHandle = handle;
+}
+
+// The bytes are exchanged right away, the completion is signaled after the duration of the transfer.
+status_t I2C_MasterTransferNonBlocking(I2C_Type *base, i2c_master_handle_t *handle, i2c_master_transfer_t *xfer)
+{
+    isClosingTouchpadWindow = false;
+    transfer_result_t result = transfer(xfer, handle->userData != NULL);
+    uint32_t bitCount = result.byteCount * 9 + result.conditionCount;
+    transferEndTime = ModelTimeMicros + ((uint64_t)bitCount * 1000000 + ModelBaudRateBps - 1) / ModelBaudRateBps + overheadMicros;
+    transferStatus = result.status;
+    isTransferPending = true;
+    return kStatus_Success;
+}
+
+// Modules
+
+static module_t *findModuleByName(const char *name)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(modules); i++) {
+        if (strcmp(modules[i].name, name) == 0) {
+            return modules + i;
+        }
+    }
+    return NULL;
+}
+
+static void setKeyState(module_t *module, uint8_t keyId, bool isPressed)
+{
+    if (keyId >= module->model->keyCount) {
+        return;
+    }
+    module->model->setKeyState(keyId, isPressed);
+    module->changeTimes[keyId][isPressed] = ModelTimeMicros;
+    module->expectedStates[keyId] = isPressed;
+    module->isLatencyPending[keyId] = true;
+    module->keyChangeCount++;
+}
+
+// Key latency spans from the change of a switch until the key states of the right half reflect it.
+static void updateKeyLatencies(void)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(modules); i++) {
+        module_t *module = modules + i;
+        uint8_t slotId = UhkModuleSlaveDriver_DriverIdToSlotId(module->driverId);
+        for (uint8_t keyId = 0; keyId < module->model->keyCount; keyId++) {
+            if (!module->isLatencyPending[keyId] || KeyStates[slotId][keyId].hardwareSwitchState != module->expectedStates[keyId]) {
+                continue;
+            }
+            uint32_t latency = ModelTimeMicros - module->changeTimes[keyId][module->expectedStates[keyId]];
+            module->isLatencyPending[keyId] = false;
+            module->latencyCount++;
+            module->latencySum += latency;
+            module->maxLatency = MAX(module->maxLatency, latency);
+        }
+    }
+}
+
+// The timestamps of the key events are compared against the time of the switch changes.
+static void takeKeyEvents(void)
+{
+    uhk_module_key_event_t events[UHK_MODULE_KEY_EVENT_QUEUE_SIZE];
+    uint8_t eventCount = UhkModuleSlaveDriver_TakeKeyEvents(events, ARRAY_SIZE(events));
+    for (uint8_t i = 0; i < eventCount; i++) {
+        uint32_t keyIndex = events[i].keyState - KeyStates[0];
+        uint8_t slotId = keyIndex / MAX_KEY_COUNT_PER_MODULE;
+        uint8_t keyId = keyIndex % MAX_KEY_COUNT_PER_MODULE;
+        module_t *module = modules + UhkModuleSlaveDriver_SlotIdToDriverId(slotId);
+        int32_t error = events[i].timeMicros - (uint32_t)module->changeTimes[keyId][events[i].active];
+        uint32_t absoluteError = error < 0 ? -error : error;
+        module->keyEventCount++;
+        module->timestampErrorSum += absoluteError;
+        module->maxTimestampError = MAX(module->maxTimestampError, absoluteError);
+    }
+}
+
+// Workload
+
+static bool parseTarget(const char *name, workload_event_t event, uint8_t *targetId)
+{
+    if (event == WorkloadEvent_Leds) {
+        for (uint8_t i = 0; i < ARRAY_SIZE(ledDrivers); i++) {
+            if (strcmp(ledDrivers[i].name, name) == 0) {
+                *targetId = i;
+                return true;
+            }
+        }
+        return false;
+    }
+    module_t *module = findModuleByName(name);
+    if (module) {
+        *targetId = module - modules;
+    }
+    return module != NULL;
+}
+
+static bool parseEvent(const char *name, workload_event_t *event)
+{
+    static const char *eventNames[] = {"keydown", "keyup", "leds", "brightness"};
+    for (uint8_t i = 0; i < ARRAY_SIZE(eventNames); i++) {
+        if (strcmp(eventNames[i], name) == 0) {
+            *event = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void readWorkload(FILE *file)
+{
+    char line[128];
+    uint32_t lineNumber = 0;
+    while (fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        double timeMs;
+        char eventName[MAX_EVENT_NAME_LENGTH];
+        char targetName[MAX_EVENT_NAME_LENGTH];
+        unsigned int argument = 0;
+        int fieldCount = sscanf(line, "%lf %15s %15s %u", &timeMs, eventName, targetName, &argument);
+        if (fieldCount <= 0) {
+            continue;
+        }
+
+        workload_item_t *item = workload + workloadLength;
+        if (
+            fieldCount < 3 ||
+            !parseEvent(eventName, &item->event) ||
+            !parseTarget(targetName, item->event, &item->targetId)
+        ) {
+            fprintf(stderr, "Invalid workload line %u: %s", lineNumber, line);
+            exit(1);
+        }
+        if (workloadLength >= MAX_WORKLOAD_ITEM_COUNT - 1) {
+            fprintf(stderr, "The workload is longer than %u lines\n", MAX_WORKLOAD_ITEM_COUNT);
+            exit(1);
+        }
+        item->time = timeMs * 1000;
+        item->argument = argument;
+        workloadLength++;
+    }
+}
+
+static void applyWorkloadItem(workload_item_t *item)
+{
+    switch (item->event) {
+        case WorkloadEvent_KeyDown:
+        case WorkloadEvent_KeyUp:
+            setKeyState(modules + item->targetId, item->argument, item->event == WorkloadEvent_KeyDown);
+            break;
+        case WorkloadEvent_Leds: {
+            uint8_t *ledValues = LedDriverValues[item->targetId];
+            for (uint16_t i = 0; i < MIN(item->argument, ledDrivers[item->targetId].ledCount); i++) {
+                ledValues[i] += 37;
+            }
+            break;
+        }
+        case WorkloadEvent_Brightness:
+            UhkModuleStates[modules[item->targetId].driverId].sourceVars.ledPwmBrightness = item->argument;
+            break;
+    }
+}
+
+// Simulation
+
+static void advanceTime(uint64_t time)
+{
+    Model_SetTime(time);
+    for (uint8_t i = 0; i < ARRAY_SIZE(modules); i++) {
+        modules[i].model->runUntil(time);
+    }
+}
+
+static void completeTransfer(void)
+{
+    isTransferPending = false;
+    if (isClosingTouchpadWindow) {
+        touchpad.isWindowOpen = false;
+        touchpad.windowClosedTime = ModelTimeMicros;
+    }
+    masterHandle->completionCallback(I2C_MAIN_BUS_BASEADDR, masterHandle, transferStatus, masterHandle->userData);
+    updateKeyLatencies();
+    takeKeyEvents();
+}
+
+static void simulate(uint64_t duration)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(modules); i++) {
+        modules[i].model->init();
+    }
+    advanceTime(0);
+    ModelBaudRateBps = I2cMainBusRequestedBaudRateBps;
+    InitSlaveScheduler();
+
+    while (true) {
+        uint64_t nextWorkloadTime = workloadPos < workloadLength ? workload[workloadPos].time : UINT64_MAX;
+        uint64_t nextTime = MIN(nextWorkloadTime, isTransferPending ? transferEndTime : UINT64_MAX);
+        if (nextTime > duration) {
+            advanceTime(duration);
+            break;
+        }
+        advanceTime(nextTime);
+        if (nextWorkloadTime == nextTime) {
+            applyWorkloadItem(workload + workloadPos++);
+        } else {
+            completeTransfer();
+        }
+    }
+}
+
+// Report
+
+static void printReport(uint64_t duration)
+{
+    printf("{\n");
+    printf("  \"device\": \"%s\",\n", DEVICE_ID == DEVICE_ID_UHK60V1 ? "uhk60v1" : "uhk60v2");
+    printf("  \"baudRate\": %u,\n", I2cMainBusRequestedBaudRateBps);
+    printf("  \"duration\": %llu,\n", (unsigned long long)duration);
+    printf("  \"overhead\": %u,\n", overheadMicros);
+
+    printf("  \"slaves\": [\n");
+    for (uint8_t slaveId = 0; slaveId < SLAVE_COUNT; slaveId++) {
+        uhk_slave_t *slave = Slaves + slaveId;
+        slave_stats_t *stats = &slave->stats;
+        printf(
+            "    {\"name\": \"%s\", \"isConnected\": %s, \"transferCount\": %u, \"byteCount\": %u, \"busTime\": %u, "
+            "\"errorCount\": %u, \"pollCount\": %u, \"pollIntervalSum\": %llu, \"maxPollInterval\": %u, "
+            "\"baudRate\": %u, \"baudRateStepDownCount\": %u}%s\n",
+            slaveNames[slaveId], slave->isConnected ? "true" : "false", stats->transferCount, stats->byteCount,
+            stats->busTime, stats->errorCount, stats->pollCount, (unsigned long long)stats->pollIntervalSum,
+            stats->maxPollInterval, GetI2cMainBusBaudRate(slave->baudRateIdx), slave->baudRateStepDownCount,
+            slaveId < SLAVE_COUNT - 1 ? "," : ""
+        );
+    }
+    printf("  ],\n");
+
+    printf("  \"modules\": [\n");
+    for (uint8_t i = 0; i < ARRAY_SIZE(modules); i++) {
+        module_t *module = modules + i;
+        uhk_module_state_t *moduleState = UhkModuleStates + module->driverId;
+        uint8_t pendingKeyChangeCount = 0;
+        for (uint8_t keyId = 0; keyId < module->model->keyCount; keyId++) {
+            pendingKeyChangeCount += module->isLatencyPending[keyId];
+        }
+        printf(
+            "    {\"name\": \"%s\", \"keyChangeCount\": %u, \"pendingKeyChangeCount\": %u, \"latencyCount\": %u, \"latencySum\": %llu, \"maxLatency\": %u, "
+            "\"keyEventCount\": %u, \"timestampErrorSum\": %llu, \"maxTimestampError\": %u, \"maxSampleAge\": %u, "
+            "\"ledPwmBrightness\": %u}%s\n",
+            module->name, module->keyChangeCount, pendingKeyChangeCount, module->latencyCount, (unsigned long long)module->latencySum,
+            module->maxLatency, module->keyEventCount, (unsigned long long)module->timestampErrorSum,
+            module->maxTimestampError, moduleState->maxSampleAge, module->model->getLedPwmBrightness(),
+            i < ARRAY_SIZE(modules) - 1 ? "," : ""
+        );
+    }
+    printf("  ],\n");
+
+    printf("  \"ledDrivers\": [\n");
+    for (uint8_t i = 0; i < ARRAY_SIZE(ledDrivers); i++) {
+        led_driver_t *ledDriver = ledDrivers + i;
+        bool isMatching = memcmp(getLedDriverPwmValues(ledDriver), LedDriverValues[i], ledDriver->ledCount) == 0;
+        printf(
+            "    {\"name\": \"%s\", \"ic\": \"%s\", \"isMatching\": %s, \"lockedPageSwitchCount\": %u}%s\n",
+            ledDriver->name, getLedDriverIcName(ledDriver->ic), isMatching ? "true" : "false",
+            ledDriver->lockedPageSwitchCount, i < ARRAY_SIZE(ledDrivers) - 1 ? "," : ""
+        );
+    }
+    printf("  ]\n");
+    printf("}\n");
+}
+
+static uint32_t getArg(int argc, char **argv, const char *name, uint32_t defaultValue)
+{
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return strtoul(argv[i + 1], NULL, 10);
+        }
+    }
+    return defaultValue;
+}
+
+static bool hasArg(int argc, char **argv, const char *name)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    I2cMainBusRequestedBaudRateBps = getArg(argc, argv, "--baud", I2C_MAIN_BUS_FAST_MODE_PLUS_BAUD_RATE);
+    overheadMicros = getArg(argc, argv, "--overhead-us", overheadMicros);
+    touchpad.isPresent = hasArg(argc, argv, "--touchpad");
+    uint64_t duration = (uint64_t)getArg(argc, argv, "--duration", 5000) * 1000;
+
+    readWorkload(stdin);
+    simulate(duration);
+    printReport(duration);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef __BUS_MODEL_H__
+#define __BUS_MODEL_H__
+
+// Includes:
+
+    #include <stdint.h>
+
+// Variables:
+
+    extern uint64_t ModelTimeMicros;
+    extern uint32_t ModelBaudRateBps; // Set by the slave scheduler through SetI2cMainBusBaudRate()
+
+// Functions:
+
+    void Model_SetTime(uint64_t timeMicros);
+
+#endif
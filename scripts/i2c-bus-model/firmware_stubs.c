@@ -0,0 +1,67 @@
+// The parts of the right half firmware which the slave scheduler and drivers reach into, reduced
+// to the state they read and write.
+
+#include "fsl_common.h"
+#include "bus_model.h"
+#include "i2c.h"
+#include "i2c_error_logger.h"
+#include "init_peripherals.h"
+#include "keymap.h"
+#include "led_display.h"
+#include "ledmap.h"
+#include "timer.h"
+#include "usb_composite_device.h"
+#include "utils.h"
+
+volatile uint32_t CurrentTime;
+volatile bool SleepModeActive;
+uint8_t CurrentKeymapIndex;
+
+uint8_t IconsAndLayerTextsBrightness = 0xff;
+uint8_t IconsAndLayerTextsBrightnessDefault = 0xff;
+uint8_t AlphanumericSegmentsBrightness = 0xff;
+uint8_t AlphanumericSegmentsBrightnessDefault = 0xff;
+
+volatile uint32_t I2cMainBusRequestedBaudRateBps = I2C_MAIN_BUS_FAST_MODE_PLUS_BAUD_RATE;
+
+const uint32_t I2cMainBusBaudRates[I2C_MAIN_BUS_BAUD_RATE_COUNT] = {
+    I2C_MAIN_BUS_FAST_MODE_PLUS_BAUD_RATE,
+    I2C_MAIN_BUS_FAST_MODE_BAUD_RATE,
+    I2C_MAIN_BUS_NORMAL_BAUD_RATE,
+};
+
+uint64_t ModelTimeMicros;
+uint32_t ModelBaudRateBps;
+
+void Model_SetTime(uint64_t timeMicros)
+{
+    ModelTimeMicros = timeMicros;
+    CurrentTime = timeMicros / 1000;
+}
+
+uint32_t Timer_GetCurrentTimeMicros()
+{
+    return ModelTimeMicros;
+}
+
+uint32_t GetI2cMainBusBaudRate(uint8_t baudRateIdx)
+{
+    return MIN(I2cMainBusBaudRates[baudRateIdx], I2cMainBusRequestedBaudRateBps);
+}
+
+void SetI2cMainBusBaudRate(uint8_t baudRateIdx)
+{
+    ModelBaudRateBps = GetI2cMainBusBaudRate(baudRateIdx);
+}
+
+void Utils_SafeStrCopy(char* target, const char* src, uint8_t max)
+{
+    uint8_t stringlength = MIN(strlen(src)+1, (max));
+    memcpy(target, src, stringlength);
+    target[stringlength-1] = '\0';
+}
+
+void LogI2cError(uint8_t slaveId, status_t status) {}
+void SwitchKeymapById(uint8_t index) {}
+void UpdateLayerLeds(void) {}
+void LedDisplay_UpdateAll(void) {}
@@ -0,0 +1,203 @@
+// Hardware of a module as seen by shared/module: the key matrix or vector, the LPTMR of the key
+// scanner and the I2C slave peripheral. Compiled once per module with its own src directory on
+// the include path and MODULE_MODEL naming the exported model.
+
+#include "fsl_common.h"
+#include "fsl_gpio.h"
+#include "fsl_i2c.h"
+#include "fsl_lptmr.h"
+#include "fsl_port.h"
+#include "i2c_addresses.h"
+#include "module.h"
+#include "module/i2c.h"
+#include "module/init_peripherals.h"
+#include "module/key_scanner.h"
+#include "module/led_pwm.h"
+#include "module/i2c_watchdog.h"
+#include "module/slave_protocol_handler.h"
+#include "module_model.h"
+
+void KEY_SCANNER_HANDLER(void);
+
+#if KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_MATRIX
+    key_matrix_t KeyMatrix = {
+        .colNum = KEYBOARD_MATRIX_COLS_NUM,
+        .rowNum = KEYBOARD_MATRIX_ROWS_NUM,
+    };
+#elif KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_VECTOR
+    key_vector_t KeyVector = {
+        .itemNum = KEYBOARD_VECTOR_ITEMS_NUM,
+    };
+#endif
+
+pointer_delta_t PointerDelta;
+volatile uint8_t PointerDeltaSequence;
+
+static bool switchStates[MODULE_KEY_COUNT];
+static uint8_t ledPwmBrightness = INITIAL_DUTY_CYCLE_PERCENT;
+
+static uint64_t currentTime;
+static uint32_t scanStepPeriodUsec;
+static uint64_t nextScanTime;
+static bool isScannerRunning;
+
+static i2c_slave_handle_t *slaveHandle;
+
+// Key arrays
+
+#if KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_MATRIX
+void KeyMatrix_ScanRow(key_matrix_t *keyMatrix)
+{
+    uint8_t rowOffset = keyMatrix->currentRowNum * keyMatrix->colNum;
+    for (uint8_t col = 0; col < keyMatrix->colNum; col++) {
+        keyMatrix->keyStates[rowOffset + col] = switchStates[rowOffset + col];
+    }
+    if (++keyMatrix->currentRowNum >= keyMatrix->rowNum) {
+        keyMatrix->currentRowNum = 0;
+    }
+}
+#elif KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_VECTOR
+void KeyVector_Scan(key_vector_t *keyVector)
+{
+    for (uint8_t item = 0; item < keyVector->itemNum; item++) {
+        keyVector->keyStates[item] = switchStates[item];
+    }
+}
+#endif
+
+// Peripherals which shared/module only initializes or drives outputs of
+
+void CLOCK_EnableClock(clock_ip_name_t name) {}
+void PORT_SetPinConfig(PORT_Type *base, uint32_t pin, const port_pin_config_t *config) {}
+void PORT_SetPinMux(PORT_Type *base, uint32_t pin, port_mux_t mux) {}
+void GPIO_PinInit(GPIO_Type *base, uint32_t pin, const gpio_pin_config_t *config) {}
+void GPIO_WritePinOutput(GPIO_Type *base, uint32_t pin, uint8_t output) {}
+void TestLed_Init(void) {}
+void LedPwm_Init(void) {}
+void RunWatchdog(void) {}
+void Module_OnScan(void) {}
+void Module_ModuleSpecificCommand(module_specific_command_t command) {}
+
+void LedPwm_SetBrightness(uint8_t brightnessPercent)
+{
+    ledPwmBrightness = brightnessPercent;
+}
+
+// Key scanner timer
+
+void LPTMR_GetDefaultConfig(lptmr_config_t *config) {}
+void LPTMR_Init(LPTMR_Type *base, const lptmr_config_t *config) {}
+void LPTMR_EnableInterrupts(LPTMR_Type *base, uint32_t mask) {}
+void LPTMR_ClearStatusFlags(LPTMR_Type *base, uint32_t mask) {}
+
+void LPTMR_SetTimerPeriod(LPTMR_Type *base, uint32_t ticks)
+{
+    scanStepPeriodUsec = (uint64_t)ticks * 1000000 / KEY_SCANNER_LPTMR_CLOCK_HZ;
+}
+
+void LPTMR_StartTimer(LPTMR_Type *base)
+{
+    isScannerRunning = true;
+    nextScanTime = currentTime + scanStepPeriodUsec;
+}
+
+void LPTMR_StopTimer(LPTMR_Type *base)
+{
+    isScannerRunning = false;
+}
+
+// I2C slave
+
+void I2C_SlaveGetDefaultConfig(i2c_slave_config_t *config) {}
+void I2C_SlaveInit(I2C_Type *base, const i2c_slave_config_t *config) {}
+
+void I2C_SlaveTransferCreateHandle(I2C_Type *base, i2c_slave_handle_t *handle, i2c_slave_transfer_callback_t callback, void *userData)
+{
+    handle->callback = callback;
+    handle->userData = userData;
+    slaveHandle = handle;
+}
+
+status_t I2C_SlaveTransferNonBlocking(I2C_Type *base, i2c_slave_handle_t *handle, uint32_t eventMask)
+{
+    handle->eventMask = eventMask;
+    return kStatus_Success;
+}
+
+static void signalSlaveEvent(uint32_t event)
+{
+    slaveHandle->transfer.event = event;
+    slaveHandle->callback(I2C_BUS_BASEADDR, &slaveHandle->transfer, slaveHandle->userData);
+}
+
+// Model
+
+static void init(void)
+{
+    InitSlaveProtocolHandler();
+    InitPeripherals();
+    InitKeyScanner();
+}
+
+static void runUntil(uint64_t timeMicros)
+{
+    while (isScannerRunning && nextScanTime <= timeMicros) {
+        currentTime = nextScanTime;
+        nextScanTime += scanStepPeriodUsec;
+        KEY_SCANNER_HANDLER();
+        PrestageKeyStatesMessage();
+    }
+    currentTime = timeMicros;
+}
+
+static void setKeyState(uint8_t keyId, bool isPressed)
+{
+    if (keyId < MODULE_KEY_COUNT) {
+        switchStates[keyId] = isPressed;
+    }
+}
+
+// Bytes reach the callback one by one through its user data, like the modules' KSDK I2C driver
+// hands them over.
+static void slaveWrite(const uint8_t *data, size_t length)
+{
+    signalSlaveEvent(kI2C_SlaveAddressMatchEvent);
+    for (size_t i = 0; i < length; i++) {
+        *(uint8_t*)slaveHandle->userData = data[i];
+        signalSlaveEvent(kI2C_SlaveReceiveEvent);
+    }
+}
+
+static size_t slaveRead(uint8_t *data, size_t length)
+{
+    signalSlaveEvent(kI2C_SlaveAddressMatchEvent);
+    signalSlaveEvent(kI2C_SlaveTransmitEvent);
+    size_t count = MIN(length, slaveHandle->transfer.dataSize);
+    memcpy(data, slaveHandle->transfer.data, count);
+    return count;
+}
+
+// The stop condition completes the transfer and wakes up the main loop.
+static void slaveStop(void)
+{
+    signalSlaveEvent(kI2C_SlaveCompletionEvent);
+    PrestageKeyStatesMessage();
+}
+
+static uint8_t getLedPwmBrightness(void)
+{
+    return ledPwmBrightness;
+}
+
+module_model_t MODULE_MODEL = {
+    .name = MODULE_MODEL_NAME,
+    .i2cAddress = I2C_ADDRESS_MODULE_FIRMWARE,
+    .keyCount = MODULE_KEY_COUNT,
+    .init = init,
+    .runUntil = runUntil,
+    .setKeyState = setKeyState,
+    .write = slaveWrite,
+    .read = slaveRead,
+    .stop = slaveStop,
+    .getLedPwmBrightness = getLedPwmBrightness,
+};
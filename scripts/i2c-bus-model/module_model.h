@@ -0,0 +1,36 @@
+#ifndef __MODULE_MODEL_H__
+#define __MODULE_MODEL_H__
+
+// Includes:
+
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+
+// Typedefs:
+
+    // Every module firmware is linked into its own object, which only exports one of these, so
+    // that the globals of shared/module don't clash between the modules and the right half.
+    typedef struct {
+        const char *name;
+        uint8_t i2cAddress;
+        uint8_t keyCount;
+        void (*init)(void);
+        // Runs the key scanner interrupts which are due until the given time, each followed by
+        // an iteration of the main loop.
+        void (*runUntil)(uint64_t timeMicros);
+        void (*setKeyState)(uint8_t keyId, bool isPressed);
+        // The master side of a transfer, driving the slave callback of shared/module/init_peripherals.c.
+        void (*write)(const uint8_t *data, size_t length);
+        size_t (*read)(uint8_t *data, size_t length);
+        void (*stop)(void);
+        uint8_t (*getLedPwmBrightness)(void);
+    } module_model_t;
+
+// Variables:
+
+    extern module_model_t LeftHalfModel;
+    extern module_model_t KeyClusterModel;
+    extern module_model_t TrackballModel;
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef __FSL_CLOCK_H__
+#define __FSL_CLOCK_H__
+
+// Includes:
+
+    #include "fsl_device_registers.h"
+
+// Macros:
+
+    #define I2C0_CLK_SRC kCLOCK_BusClk
+    #define I2C1_CLK_SRC kCLOCK_BusClk
+
+// Typedefs:
+
+    typedef enum {
+        kCLOCK_CoreSysClk,
+        kCLOCK_BusClk,
+        kCLOCK_LpoClk,
+    } clock_name_t;
+
+    typedef enum {
+        kCLOCK_PortA,
+        kCLOCK_PortB,
+        kCLOCK_PortC,
+        kCLOCK_PortD,
+        kCLOCK_PortE,
+        kCLOCK_I2c0,
+        kCLOCK_I2c1,
+        kCLOCK_Lptmr0,
+        kCLOCK_Tpm0,
+        kCLOCK_Tpm1,
+        kCLOCK_Spi0,
+    } clock_ip_name_t;
+
+// Functions:
+
+    uint32_t CLOCK_GetFreq(clock_name_t name);
+    void CLOCK_EnableClock(clock_ip_name_t name);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef __FSL_COMMON_H__
+#define __FSL_COMMON_H__
+
+// The parts of the KSDK which the slave scheduler, the slave drivers and the slave side of the
+// module firmware use, so that they can be compiled for the host.
+
+// Includes:
+
+    #include <assert.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <string.h>
+    #include "fsl_device_registers.h"
+    #include "fsl_clock.h"
+
+// Macros:
+
+    #define MAKE_STATUS(group, code) ((((group)*100) + (code)))
+
+    #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+    #define MIN(a, b) ((a) < (b) ? (a) : (b))
+    #define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+    #define USEC_TO_COUNT(us, clockFreqInHz) (uint64_t)((uint64_t)(us) * (clockFreqInHz) / 1000000U)
+
+// Typedefs:
+
+    typedef int32_t status_t;
+
+    enum {
+        kStatusGroup_Generic = 0,
+        kStatusGroup_I2C = 13,
+        kStatusGroup_ApplicationRangeStart = 100,
+    };
+
+    enum {
+        kStatus_Success = MAKE_STATUS(kStatusGroup_Generic, 0),
+        kStatus_Fail = MAKE_STATUS(kStatusGroup_Generic, 1),
+        kStatus_ReadOnly = MAKE_STATUS(kStatusGroup_Generic, 2),
+        kStatus_OutOfRange = MAKE_STATUS(kStatusGroup_Generic, 3),
+        kStatus_InvalidArgument = MAKE_STATUS(kStatusGroup_Generic, 4),
+        kStatus_Timeout = MAKE_STATUS(kStatusGroup_Generic, 5),
+        kStatus_NoTransferInProgress = MAKE_STATUS(kStatusGroup_Generic, 6),
+    };
+
+// Functions:
+
+    // The model runs everything in a single thread, so interrupts needn't be masked.
+    static inline void __disable_irq(void) {}
+    static inline void __enable_irq(void) {}
+    static inline void __DMB(void) {}
+    static inline uint32_t DisableGlobalIRQ(void) { return 0; }
+    static inline void EnableGlobalIRQ(uint32_t primask) {}
+    static inline void EnableIRQ(IRQn_Type interrupt) {}
+    static inline void DisableIRQ(IRQn_Type interrupt) {}
+    static inline void NVIC_SetPriority(IRQn_Type interrupt, uint32_t priority) {}
+    static inline void NVIC_SystemReset(void) {}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __FSL_DEVICE_REGISTERS_H__
+#define __FSL_DEVICE_REGISTERS_H__
+
+// Includes:
+
+    #include <stdint.h>
+
+// Macros:
+
+    // Peripherals are only passed around as base addresses, which are never dereferenced.
+    #define PORTA  ((PORT_Type*)0x40049000u)
+    #define PORTB  ((PORT_Type*)0x4004A000u)
+    #define PORTC  ((PORT_Type*)0x4004B000u)
+    #define PORTD  ((PORT_Type*)0x4004C000u)
+    #define PORTE  ((PORT_Type*)0x4004D000u)
+    #define GPIOA  ((GPIO_Type*)0x400FF000u)
+    #define GPIOB  ((GPIO_Type*)0x400FF040u)
+    #define GPIOC  ((GPIO_Type*)0x400FF080u)
+    #define GPIOD  ((GPIO_Type*)0x400FF0C0u)
+    #define GPIOE  ((GPIO_Type*)0x400FF100u)
+    #define I2C0   ((I2C_Type*)0x40066000u)
+    #define I2C1   ((I2C_Type*)0x40067000u)
+    #define TPM0   ((TPM_Type*)0x40038000u)
+    #define TPM1   ((TPM_Type*)0x40039000u)
+    #define LPTMR0 ((LPTMR_Type*)0x40040000u)
+    #define SPI0   ((SPI_Type*)0x4002C000u)
+
+// Typedefs:
+
+    typedef struct {
+        volatile uint32_t PCR[32];
+        volatile uint32_t ISFR;
+    } PORT_Type;
+
+    typedef struct {
+        volatile uint32_t PDOR;
+        volatile uint32_t PSOR;
+        volatile uint32_t PCOR;
+        volatile uint32_t PTOR;
+        volatile uint32_t PDIR;
+        volatile uint32_t PDDR;
+    } GPIO_Type;
+
+    typedef struct {
+        volatile uint8_t A1;
+        volatile uint8_t F;
+        volatile uint8_t C1;
+        volatile uint8_t S;
+        volatile uint8_t D;
+        volatile uint8_t C2;
+        volatile uint8_t FLT;
+        volatile uint8_t RA;
+        volatile uint8_t SMB;
+        volatile uint8_t A2;
+        volatile uint8_t SLTH;
+        volatile uint8_t SLTL;
+    } I2C_Type;
+
+    typedef struct {
+        volatile uint32_t SC;
+    } TPM_Type;
+
+    typedef struct {
+        volatile uint32_t CSR;
+    } LPTMR_Type;
+
+    typedef struct {
+        volatile uint8_t S;
+    } SPI_Type;
+
+    typedef enum {
+        I2C0_IRQn,
+        I2C1_IRQn,
+        LPTMR0_IRQn,
+        TPM0_IRQn,
+        TPM1_IRQn,
+        SPI0_IRQn,
+        USB0_IRQn,
+    } IRQn_Type;
+
+#endif
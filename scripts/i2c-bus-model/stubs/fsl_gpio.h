@@ -0,0 +1,31 @@
+#ifndef __FSL_GPIO_H__
+#define __FSL_GPIO_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Typedefs:
+
+    typedef enum {
+        kGPIO_DigitalInput,
+        kGPIO_DigitalOutput,
+    } gpio_pin_direction_t;
+
+    typedef struct {
+        gpio_pin_direction_t pinDirection;
+        uint8_t outputLogic;
+    } gpio_pin_config_t;
+
+// Functions:
+
+    void GPIO_PinInit(GPIO_Type *base, uint32_t pin, const gpio_pin_config_t *config);
+    void GPIO_WritePinOutput(GPIO_Type *base, uint32_t pin, uint8_t output);
+    uint32_t GPIO_ReadPinInput(GPIO_Type *base, uint32_t pin);
+
+    // Only drive the test LED, whose state isn't modeled.
+    static inline void GPIO_SetPinsOutput(GPIO_Type *base, uint32_t mask) {}
+    static inline void GPIO_ClearPinsOutput(GPIO_Type *base, uint32_t mask) {}
+    static inline void GPIO_TogglePinsOutput(GPIO_Type *base, uint32_t mask) {}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef __FSL_I2C_H__
+#define __FSL_I2C_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Typedefs:
+
+    enum {
+        kStatus_I2C_Busy = MAKE_STATUS(kStatusGroup_I2C, 0),
+        kStatus_I2C_Idle = MAKE_STATUS(kStatusGroup_I2C, 1),
+        kStatus_I2C_Nak = MAKE_STATUS(kStatusGroup_I2C, 2),
+        kStatus_I2C_ArbitrationLost = MAKE_STATUS(kStatusGroup_I2C, 3),
+        kStatus_I2C_Timeout = MAKE_STATUS(kStatusGroup_I2C, 4),
+    };
+
+    typedef enum {
+        kI2C_Write,
+        kI2C_Read,
+    } i2c_direction_t;
+
+    enum {
+        kI2C_SlaveAddressMatchEvent = 0x01,
+        kI2C_SlaveTransmitEvent = 0x02,
+        kI2C_SlaveReceiveEvent = 0x04,
+        kI2C_SlaveTransmitAckEvent = 0x08,
+        kI2C_SlaveCompletionEvent = 0x20,
+    };
+
+    // Master
+
+    typedef struct {
+        uint32_t flags;
+        uint8_t slaveAddress;
+        i2c_direction_t direction;
+        uint32_t subaddress;
+        uint8_t subaddressSize;
+        uint8_t *volatile data;
+        volatile size_t dataSize;
+    } i2c_master_transfer_t;
+
+    typedef struct _i2c_master_handle i2c_master_handle_t;
+
+    typedef void (*i2c_master_transfer_callback_t)(I2C_Type *base, i2c_master_handle_t *handle, status_t status, void *userData);
+
+    struct _i2c_master_handle {
+        i2c_master_transfer_t transfer;
+        i2c_master_transfer_callback_t completionCallback;
+        void *userData;
+    };
+
+    // Slave
+
+    typedef struct {
+        bool enableSlave;
+        uint16_t slaveAddress;
+    } i2c_slave_config_t;
+
+    typedef struct {
+        uint32_t event;
+        uint8_t *volatile data;
+        volatile size_t dataSize;
+        status_t completionStatus;
+        size_t transferredCount;
+    } i2c_slave_transfer_t;
+
+    typedef struct _i2c_slave_handle i2c_slave_handle_t;
+
+    typedef void (*i2c_slave_transfer_callback_t)(I2C_Type *base, i2c_slave_transfer_t *xfer, void *userData);
+
+    struct _i2c_slave_handle {
+        i2c_slave_transfer_t transfer;
+        uint32_t eventMask;
+        i2c_slave_transfer_callback_t callback;
+        void *userData;
+    };
+
+// Functions:
+
+    void I2C_MasterTransferCreateHandle(I2C_Type *base, i2c_master_handle_t *handle, i2c_master_transfer_callback_t callback, void *userData);
+    status_t I2C_MasterTransferNonBlocking(I2C_Type *base, i2c_master_handle_t *handle, i2c_master_transfer_t *xfer);
+
+    void I2C_SlaveGetDefaultConfig(i2c_slave_config_t *config);
+    void I2C_SlaveInit(I2C_Type *base, const i2c_slave_config_t *config);
+    void I2C_SlaveTransferCreateHandle(I2C_Type *base, i2c_slave_handle_t *handle, i2c_slave_transfer_callback_t callback, void *userData);
+    status_t I2C_SlaveTransferNonBlocking(I2C_Type *base, i2c_slave_handle_t *handle, uint32_t eventMask);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __FSL_LPTMR_H__
+#define __FSL_LPTMR_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Typedefs:
+
+    typedef enum {
+        kLPTMR_PrescalerClock_0,
+        kLPTMR_PrescalerClock_1,
+    } lptmr_prescaler_clock_select_t;
+
+    typedef enum {
+        kLPTMR_Prescale_Glitch_0,
+        kLPTMR_Prescale_Glitch_1,
+        kLPTMR_Prescale_Glitch_2,
+    } lptmr_prescaler_glitch_value_t;
+
+    typedef struct {
+        bool enableFreeRunning;
+        bool bypassPrescaler;
+        lptmr_prescaler_clock_select_t prescalerClockSource;
+        lptmr_prescaler_glitch_value_t value;
+    } lptmr_config_t;
+
+    enum {
+        kLPTMR_TimerInterruptEnable = 1,
+        kLPTMR_TimerCompareFlag = 1,
+    };
+
+// Functions:
+
+    // The model calls the scanner handler on its own schedule, so the timer is only recorded.
+    void LPTMR_GetDefaultConfig(lptmr_config_t *config);
+    void LPTMR_Init(LPTMR_Type *base, const lptmr_config_t *config);
+    void LPTMR_SetTimerPeriod(LPTMR_Type *base, uint32_t ticks);
+    void LPTMR_EnableInterrupts(LPTMR_Type *base, uint32_t mask);
+    void LPTMR_StartTimer(LPTMR_Type *base);
+    void LPTMR_StopTimer(LPTMR_Type *base);
+    void LPTMR_ClearStatusFlags(LPTMR_Type *base, uint32_t mask);
+
+#endif
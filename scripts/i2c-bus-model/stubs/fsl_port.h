@@ -0,0 +1,42 @@
+#ifndef __FSL_PORT_H__
+#define __FSL_PORT_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Typedefs:
+
+    typedef enum {
+        kPORT_PinDisabledOrAnalog,
+        kPORT_MuxAsGpio,
+        kPORT_MuxAlt2,
+        kPORT_MuxAlt3,
+        kPORT_MuxAlt4,
+        kPORT_MuxAlt5,
+        kPORT_MuxAlt6,
+        kPORT_MuxAlt7,
+    } port_mux_t;
+
+    typedef enum {
+        kPORT_PullDisable,
+        kPORT_PullDown = 2,
+        kPORT_PullUp,
+    } port_pull_t;
+
+    typedef struct {
+        uint16_t pullSelect : 2;
+        uint16_t slewRate : 1;
+        uint16_t passiveFilterEnable : 1;
+        uint16_t openDrainEnable : 1;
+        uint16_t driveStrength : 1;
+        uint16_t mux : 3;
+        uint16_t lockRegister : 1;
+    } port_pin_config_t;
+
+// Functions:
+
+    void PORT_SetPinConfig(PORT_Type *base, uint32_t pin, const port_pin_config_t *config);
+    void PORT_SetPinMux(PORT_Type *base, uint32_t pin, port_mux_t mux);
+
+#endif
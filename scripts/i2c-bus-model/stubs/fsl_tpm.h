@@ -0,0 +1,15 @@
+#ifndef __FSL_TPM_H__
+#define __FSL_TPM_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Typedefs:
+
+    typedef enum {
+        kTPM_Chnl_0,
+        kTPM_Chnl_1,
+    } tpm_chnl_t;
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef __USB_H__
+#define __USB_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Macros:
+
+    #define __packed __attribute__((packed))
+
+// Typedefs:
+
+    typedef enum {
+        kStatus_USB_Success,
+        kStatus_USB_Error,
+        kStatus_USB_Busy,
+        kStatus_USB_InvalidHandle,
+        kStatus_USB_InvalidParameter,
+        kStatus_USB_InvalidRequest,
+    } usb_status_t;
+
+    typedef enum {
+        kUSB_ControllerKhci0,
+    } usb_controller_index_t;
+
+    typedef void *usb_device_handle;
+
+#endif
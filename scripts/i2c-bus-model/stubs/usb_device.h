@@ -0,0 +1,41 @@
+#ifndef __USB_DEVICE_H__
+#define __USB_DEVICE_H__
+
+// Includes:
+
+    #include "usb.h"
+
+// Macros:
+
+    #define USB_SETUP_PACKET_SIZE 8
+
+// Typedefs:
+
+    typedef enum {
+        kUSB_DeviceEventBusReset = 1,
+        kUSB_DeviceEventSuspend,
+        kUSB_DeviceEventResume,
+        kUSB_DeviceEventError,
+        kUSB_DeviceEventDetach,
+        kUSB_DeviceEventAttach,
+        kUSB_DeviceEventSetConfiguration,
+        kUSB_DeviceEventSetInterface,
+    } usb_device_event_t;
+
+    typedef struct {
+        uint8_t bmRequestType;
+        uint8_t bRequest;
+        uint16_t wValue;
+        uint16_t wIndex;
+        uint16_t wLength;
+    } usb_setup_struct_t;
+
+    typedef usb_status_t (*usb_device_callback_t)(usb_device_handle handle, uint32_t callbackEvent, void *eventParam);
+
+// Functions:
+
+    usb_status_t USB_DeviceInit(uint8_t controllerId, usb_device_callback_t deviceCallback, usb_device_handle *handle);
+    usb_status_t USB_DeviceSendRequest(usb_device_handle handle, uint8_t endpointAddress, uint8_t *buffer, uint32_t length);
+    usb_status_t USB_DeviceRecvRequest(usb_device_handle handle, uint8_t endpointAddress, uint8_t *buffer, uint32_t length);
+
+#endif
@@ -0,0 +1,124 @@
+#!/usr/bin/env node
+// Runs the slave scheduler and the slave drivers of the right half against the module firmware and
+// models of the IS31FL3731/3737/3199 register files and the IQS5xx touchpad, all compiled for the
+// host by i2c-bus-model/Makefile. Reports bus occupancy, per-slave service intervals and module key
+// event latency for a scripted workload.
+//
+// Usage: ./simulate-i2c-bus.js [workload.json] [--baud BPS] [--duration MS] [--overhead-us US] [--v1] [--touchpad]
+//
+// A workload is an array of {"type", "target", "start", "period", "count"} items, times in ms:
+// - keypress: presses and releases key `count` (0 by default) of a module ("leftHalf", "leftModule" or "rightModule")
+// - leds: changes `count` values of a LED driver ("rightLeds", "leftLeds" or "moduleLeds")
+// - brightness: makes the master send LED brightness `count` (50 by default) to a module
+
+const fs = require('fs');
+const path = require('path');
+const childProcess = require('child_process');
+
+const KEY_PRESS_DURATION_MS = 40;
+
+const defaultWorkload = [
+    {type: 'keypress', target: 'leftHalf', start: 0, period: 120},
+    {type: 'keypress', target: 'leftModule', start: 55, period: 700},
+    {type: 'leds', target: 'rightLeds', start: 500, period: 1000, count: 192},
+    {type: 'leds', target: 'leftLeds', start: 500, period: 1000, count: 192},
+    {type: 'leds', target: 'moduleLeds', start: 500, period: 1000, count: 9},
+    {type: 'brightness', target: 'leftHalf', start: 2500, period: 0},
+];
+
+function getArg(name, defaultValue) {
+    const index = process.argv.indexOf(name);
+    return index === -1 ? defaultValue : Number(process.argv[index + 1]);
+}
+
+// Expands the workload into the time ordered event lines read by the bus model.
+function getWorkloadLines(workload, durationMs) {
+    const events = workload.flatMap(item => {
+        const times = [];
+        for (let time = item.start; time <= durationMs && (item.period || times.length === 0); time += item.period || 1) {
+            times.push(time);
+        }
+        return times.flatMap(time => {
+            switch (item.type) {
+                case 'keypress':
+                    return [
+                        {time, line: `keydown ${item.target} ${item.count || 0}`},
+                        {time: time + KEY_PRESS_DURATION_MS, line: `keyup ${item.target} ${item.count || 0}`},
+                    ];
+                case 'leds':
+                    return [{time, line: `leds ${item.target} ${item.count}`}];
+                case 'brightness':
+                    return [{time, line: `brightness ${item.target} ${item.count === undefined ? 50 : item.count}`}];
+                default:
+                    throw new Error(`Unknown workload item type ${item.type}`);
+            }
+        });
+    });
+    return events
+        .sort((a, b) => a.time - b.time)
+        .map(event => `${event.time} ${event.line}\n`)
+        .join('');
+}
+
+function summarize(sum, count, max) {
+    return count ? `${(Number(sum) / count).toFixed(0)}/${max}` : '-';
+}
+
+const workloadPath = process.argv[2] && !process.argv[2].startsWith('--') ? process.argv[2] : null;
+const workload = workloadPath ? JSON.parse(fs.readFileSync(workloadPath)) : defaultWorkload;
+const baudRate = getArg('--baud', 1000000);
+const durationMs = getArg('--duration', 5000);
+const overheadUs = getArg('--overhead-us', 15);
+const device = process.argv.includes('--v1') ? 'uhk60v1' : 'uhk60v2';
+const hasTouchpad = process.argv.includes('--touchpad');
+
+const modelDir = path.join(__dirname, 'i2c-bus-model');
+childProcess.execFileSync('make', ['-s', '-C', modelDir], {stdio: 'inherit'});
+
+const modelArgs = ['--baud', baudRate, '--duration', durationMs, '--overhead-us', overheadUs].map(String);
+if (hasTouchpad) {
+    modelArgs.push('--touchpad');
+}
+const output = childProcess.execFileSync(path.join(modelDir, 'build', `bus-model-${device}`), modelArgs, {
+    input: getWorkloadLines(workload, durationMs),
+});
+const report = JSON.parse(output);
+
+const durationUs = report.duration;
+const totalBusTime = report.slaves.reduce((sum, slave) => sum + slave.busTime, 0);
+const modules = Object.fromEntries(report.modules.map(module => [module.name, module]));
+
+console.log(`Workload: ${workloadPath || 'default'}, ${device}, ${baudRate / 1000} kHz, ${durationMs} ms, ${overheadUs} us overhead per transfer`);
+console.log(`Bus occupancy: ${(100 * totalBusTime / durationUs).toFixed(1)}%`);
+console.log('slave        transfers   bytes  errors  bus share  rate (kHz)  poll interval mean/max (us)  key latency mean/max (us)  timestamp error mean/max (us)');
+for (const slave of report.slaves) {
+    const module = modules[slave.name];
+    const busShare = `${(100 * slave.busTime / durationUs).toFixed(1)}%`;
+    const latency = module ? summarize(module.latencySum, module.latencyCount, module.maxLatency) : '';
+    const timestampError = module ? summarize(module.timestampErrorSum, module.keyEventCount, module.maxTimestampError) : '';
+    console.log(
+        `${slave.name.padEnd(12)} ${String(slave.transferCount).padStart(9)} ${String(slave.byteCount).padStart(7)} ` +
+        `${String(slave.errorCount).padStart(7)} ${busShare.padStart(10)}  ${String(slave.baudRate / 1000).padStart(10)}  ` +
+        `${summarize(slave.pollIntervalSum, slave.pollCount, slave.maxPollInterval).padStart(27)}  ` +
+        `${latency.padStart(25)}  ${timestampError.padStart(29)}`
+    );
+}
+
+let isFailed = false;
+for (const ledDriver of report.ledDrivers) {
+    console.log(`${ledDriver.name} ${ledDriver.ic} PWM registers ${ledDriver.isMatching ? 'match' : 'differ from'} the LED values`);
+    if (ledDriver.lockedPageSwitchCount) {
+        console.log(`${ledDriver.name} ${ledDriver.ic} ignored ${ledDriver.lockedPageSwitchCount} page switches while locked`);
+    }
+    isFailed = isFailed || !ledDriver.isMatching || ledDriver.lockedPageSwitchCount > 0;
+}
+for (const module of report.modules) {
+    // Changes which the master hasn't seen by the end of the run are still in flight.
+    const lostEventCount = module.keyChangeCount - module.pendingKeyChangeCount - module.keyEventCount;
+    if (lostEventCount > 0) {
+        console.log(`${module.name} lost ${lostEventCount} of ${module.keyChangeCount} key events`);
+    }
+    console.log(`${module.name} LED brightness is ${module.ledPwmBrightness}%, max sample age ${module.maxSampleAge} us`);
+}
+
+process.exit(isFailed ? 1 : 0);
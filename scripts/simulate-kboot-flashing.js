@@ -0,0 +1,165 @@
+#!/usr/bin/env node
+// Pushes a module firmware through a model of the BusPal bridge (see right/src/buspal/command.c) into
+// a model of the KL03 ROM bootloader's I2C framing, verifies that the image arrives intact, and
+// compares the write-memory data phase timing of the original bridge with the pipelined one.
+//
+// Usage: ./simulate-kboot-flashing.js [module.bin] [--program-us US] [--corrupt PACKET]
+
+const fs = require('fs');
+
+const FRAME_US = 1000; // interrupt endpoint polling interval
+const MAX_PAYLOAD_SIZE = 32; // kMinPacketBufferSize of the ROM bootloader
+const FLASH_SIZE = 32 * 1024;
+const ERRATA_DELAY_US = 1000; // initial delay of WaitForStartByte()
+
+const FramingPacket = {
+    StartByte: 0x5a,
+    Ack: 0xa1,
+    Nak: 0xa2,
+    Data: 0xa5,
+};
+
+const bridges = {
+    original: {baudRate: 30000, pollIntervalUs: 500, isPrefetching: false},
+    pipelined: {baudRate: 100000, pollIntervalUs: 100, isPrefetching: true},
+};
+
+function getArg(name, defaultValue) {
+    const index = process.argv.indexOf(name);
+    return index === -1 ? defaultValue : Number(process.argv[index + 1]);
+}
+
+function crc16(data) {
+    let crc = 0;
+    for (const byte of data) {
+        crc ^= byte << 8;
+        for (let i = 0; i < 8; i++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+            crc &= 0xffff;
+        }
+    }
+    return crc;
+}
+
+// Same layout as framing_data_packet_t followed by the payload.
+function frameDataPacket(payload) {
+    const header = Buffer.from([FramingPacket.StartByte, FramingPacket.Data, payload.length & 0xff, payload.length >> 8]);
+    const crc = crc16(Buffer.concat([header, payload]));
+    return Buffer.concat([header, Buffer.from([crc & 0xff, crc >> 8]), payload]);
+}
+
+// Model of the I2C peripheral of the KL03 ROM bootloader during a write-memory data phase.
+class SimulatedRomBootloader {
+    constructor(address, programUsPerWord) {
+        this.flash = Buffer.alloc(FLASH_SIZE, 0xff);
+        this.address = address;
+        this.programUsPerWord = programUsPerWord;
+        this.responseReadyAt = 0;
+        this.response = null;
+    }
+
+    write(frame, time) {
+        if (frame[0] !== FramingPacket.StartByte || frame[1] !== FramingPacket.Data) {
+            throw new Error(`Unexpected framing packet 0x${frame.subarray(0, 2).toString('hex')}`);
+        }
+        const length = frame.readUInt16LE(2);
+        const payload = frame.subarray(6, 6 + length);
+        const isValid = length <= MAX_PAYLOAD_SIZE &&
+            payload.length === length &&
+            crc16(Buffer.concat([frame.subarray(0, 4), payload])) === frame.readUInt16LE(4);
+        if (isValid) {
+            payload.copy(this.flash, this.address);
+            this.address += length;
+        }
+        this.response = isValid ? FramingPacket.Ack : FramingPacket.Nak;
+        this.responseReadyAt = time + (isValid ? Math.ceil(length / 4) * this.programUsPerWord : 0);
+    }
+
+    // The ROM answers 0x00 until its response is ready.
+    readByte(time) {
+        return time >= this.responseReadyAt ? FramingPacket.StartByte : 0;
+    }
+
+    readResponseType() {
+        return this.response;
+    }
+}
+
+function i2cTransferUs(byteCount, baudRate) {
+    return Math.ceil((byteCount + 1) * 9 * 1e6 / baudRate); // plus the address byte
+}
+
+function nextFrame(time) {
+    return Math.ceil(time / FRAME_US) * FRAME_US;
+}
+
+function simulateDataPhase(firmware, bridge, programUsPerWord, corruptPacketIdx) {
+    const rom = new SimulatedRomBootloader(0, programUsPerWord);
+    let time = 0;
+    let packetArrivesAt = FRAME_US;
+    let packetIdx = 0;
+
+    for (let offset = 0; offset < firmware.length; offset += MAX_PAYLOAD_SIZE, packetIdx++) {
+        // usb_hid_packet_read() waits for the report from the host.
+        time = Math.max(time, packetArrivesAt);
+        const payload = Buffer.from(firmware.subarray(offset, offset + MAX_PAYLOAD_SIZE));
+        const frame = frameDataPacket(payload);
+        if (packetIdx === corruptPacketIdx) {
+            frame[frame.length - 1] ^= 0x01;
+        }
+
+        // The host sends the next report in the first frame after the out pipe got armed.
+        if (bridge.isPrefetching) {
+            packetArrivesAt = nextFrame(time + 1);
+        }
+
+        time += i2cTransferUs(frame.length, bridge.baudRate);
+        rom.write(frame, time);
+
+        // WaitForStartByte()
+        time += ERRATA_DELAY_US;
+        while (true) {
+            time += i2cTransferUs(1, bridge.baudRate);
+            if (rom.readByte(time) === FramingPacket.StartByte) {
+                break;
+            }
+            time += bridge.pollIntervalUs;
+        }
+        time += i2cTransferUs(1, bridge.baudRate);
+        if (rom.readResponseType() !== FramingPacket.Ack) {
+            return {status: `NAK at packet ${packetIdx}`, time, image: rom.flash};
+        }
+
+        if (!bridge.isPrefetching) {
+            packetArrivesAt = nextFrame(time + 1);
+        }
+    }
+    return {status: 'ok', time, image: rom.flash};
+}
+
+function syntheticFirmware() {
+    return Buffer.from(Array.from({length: 24 * 1024}, (_, i) => (i * 31 + (i >> 8)) & 0xff));
+}
+
+const firmwarePath = process.argv[2] && !process.argv[2].startsWith('--') ? process.argv[2] : null;
+const firmware = firmwarePath ? fs.readFileSync(firmwarePath) : syntheticFirmware();
+const programUsPerWord = getArg('--program-us', 65);
+const corruptPacketIdx = getArg('--corrupt', -1);
+
+if (firmware.length > FLASH_SIZE) {
+    console.error(`${firmware.length} bytes don't fit into the ${FLASH_SIZE} bytes of flash`);
+    process.exit(1);
+}
+
+console.log(`Firmware: ${firmwarePath || 'synthetic'}, ${firmware.length} bytes, ${Math.ceil(firmware.length / MAX_PAYLOAD_SIZE)} packets`);
+
+let isFailed = false;
+for (const [name, bridge] of Object.entries(bridges)) {
+    const result = simulateDataPhase(firmware, bridge, programUsPerWord, corruptPacketIdx);
+    const isIntact = result.image.subarray(0, firmware.length).equals(firmware);
+    const label = `${name}:`.padEnd(11);
+    console.log(`${label} ${(result.time / 1000).toFixed(1)} ms at ${bridge.baudRate / 1000} kHz, ${result.status}, image ${isIntact ? 'intact' : 'differs'}`);
+    isFailed = isFailed || isIntact !== (corruptPacketIdx === -1);
+}
+
+process.exit(isFailed ? 1 : 0);
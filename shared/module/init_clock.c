@@ -14,7 +14,7 @@ void InitClock(void)
     // Bus clock: 24MHz
     const mcglite_config_t mcgliteConfig = {
         .outSrc = kMCGLITE_ClkSrcHirc,
-        .irclkEnableMode = 0U,
+        .irclkEnableMode = kMCGLITE_IrclkEnable, // Clocks the key scanner
         .ircs = kMCGLITE_Lirc8M,
         .fcrdiv = kMCGLITE_LircDivBy1,
         .lircDiv2 = kMCGLITE_LircDivBy1,
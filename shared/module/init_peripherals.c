@@ -24,11 +24,12 @@ static void i2cSlaveCallback(I2C_Type *base, i2c_slave_transfer_t *xfer, void *u
     dosBuffer[1] = userData;
 
     switch (xfer->event) {
-        case kI2C_SlaveTransmitEvent:
-            SlaveTxHandler();
-            xfer->data = (uint8_t*)&TxMessage;
-            xfer->dataSize = TxMessage.length + I2C_MESSAGE_HEADER_LENGTH;
+        case kI2C_SlaveTransmitEvent: {
+            i2c_message_t *txMessage = SlaveTxHandler();
+            xfer->data = (uint8_t*)txMessage;
+            xfer->dataSize = txMessage->length + I2C_MESSAGE_HEADER_LENGTH;
             break;
+        }
         case kI2C_SlaveAddressMatchEvent:
             rxMessagePos = 0;
             break;
@@ -38,6 +39,9 @@ static void i2cSlaveCallback(I2C_Type *base, i2c_slave_transfer_t *xfer, void *u
                 SlaveRxHandler();
             }
             break;
+        case kI2C_SlaveCompletionEvent:
+            SlaveTransferCompleted();
+            break;
         default:
             break;
     }
@@ -67,7 +71,7 @@ void initI2c(void)
     slaveConfig.slaveAddress = I2C_ADDRESS_MODULE_FIRMWARE;
     I2C_SlaveInit(I2C_BUS_BASEADDR, &slaveConfig);
     I2C_SlaveTransferCreateHandle(I2C_BUS_BASEADDR, &slaveHandle, i2cSlaveCallback, &userData);
-    I2C_SlaveTransferNonBlocking(I2C_BUS_BASEADDR, &slaveHandle, kI2C_SlaveAddressMatchEvent);
+    I2C_SlaveTransferNonBlocking(I2C_BUS_BASEADDR, &slaveHandle, kI2C_SlaveAddressMatchEvent | kI2C_SlaveCompletionEvent);
 }
 
 void InitLedDriver(void)
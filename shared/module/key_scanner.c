@@ -3,31 +3,89 @@
 #include "module/i2c_watchdog.h"
 #include "module.h"
 
+volatile uint16_t KeyScannerTick;
+volatile uint16_t KeyScannerSampleTick;
+
+// Period of a single handler call, which scans a single row of matrices.
+static uint16_t scanStepPeriodUsec;
+static uint16_t tickRemainderUsec;
+static uint16_t millisecondRemainderUsec;
+
+// Every key state change gets recorded here, so that the master can tell the order of
+// changes which happen between two of its polls. KeyEventHead only ever grows.
+module_key_event_t KeyEvents[KEY_EVENT_QUEUE_SIZE];
+volatile uint8_t KeyEventHead;
+
+static uint8_t previousKeyStates[MODULE_KEY_COUNT];
+
+static void queueKeyEvents(uint8_t *keyStates, uint8_t firstKeyId, uint8_t keyCount)
+{
+    for (uint8_t keyId = firstKeyId; keyId < firstKeyId + keyCount; keyId++) {
+        if (keyStates[keyId] == previousKeyStates[keyId]) {
+            continue;
+        }
+        previousKeyStates[keyId] = keyStates[keyId];
+        module_key_event_t *keyEvent = KeyEvents + KeyEventHead % KEY_EVENT_QUEUE_SIZE;
+        keyEvent->keyIdAndState = keyId | (keyStates[keyId] ? MODULE_KEY_EVENT_PRESSED_MASK : 0);
+        keyEvent->tick = KeyScannerTick;
+        KeyEventHead++;
+    }
+}
+
 void KEY_SCANNER_HANDLER(void)
 {
+    tickRemainderUsec += scanStepPeriodUsec;
+    while (tickRemainderUsec >= MODULE_KEY_EVENT_TICK_USEC) {
+        tickRemainderUsec -= MODULE_KEY_EVENT_TICK_USEC;
+        KeyScannerTick++;
+    }
+
     #if KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_VECTOR
         KeyVector_Scan(&KeyVector);
+        queueKeyEvents(KeyVector.keyStates, 0, MODULE_KEY_COUNT);
+        KeyScannerSampleTick = KeyScannerTick;
     #elif KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_MATRIX
+        uint8_t rowNum = KeyMatrix.currentRowNum;
         KeyMatrix_ScanRow(&KeyMatrix);
+        queueKeyEvents(KeyMatrix.keyStates, rowNum * KeyMatrix.colNum, KeyMatrix.colNum);
+        if (KeyMatrix.currentRowNum == 0) {
+            KeyScannerSampleTick = KeyScannerTick;
+        }
     #endif
-    RunWatchdog();
-    Module_OnScan();
+
+    // The watchdog and the module hooks count in milliseconds regardless of the scan period.
+    millisecondRemainderUsec += scanStepPeriodUsec;
+    while (millisecondRemainderUsec >= 1000) {
+        millisecondRemainderUsec -= 1000;
+        RunWatchdog();
+        Module_OnScan();
+    }
     LPTMR_ClearStatusFlags(KEY_SCANNER_LPTMR_BASEADDR, kLPTMR_TimerCompareFlag);
 }
 
+// The period is that of a full scan, so matrices scan a row every period / row count.
+void KeyScanner_SetScanPeriod(uint16_t scanPeriodUsec)
+{
+    scanPeriodUsec = MAX(MODULE_MIN_SCAN_PERIOD_USEC, MIN(scanPeriodUsec, MODULE_MAX_SCAN_PERIOD_USEC));
+    scanStepPeriodUsec = scanPeriodUsec / KEY_SCANNER_SCAN_COUNT_PER_MSEC;
+
+    // The compare value may only be changed while the timer is stopped.
+    LPTMR_StopTimer(KEY_SCANNER_LPTMR_BASEADDR);
+    LPTMR_SetTimerPeriod(KEY_SCANNER_LPTMR_BASEADDR, USEC_TO_COUNT(scanStepPeriodUsec, KEY_SCANNER_LPTMR_CLOCK_HZ));
+    LPTMR_StartTimer(KEY_SCANNER_LPTMR_BASEADDR);
+}
+
 void InitKeyScanner(void)
 {
     lptmr_config_t lptmrConfig;
     LPTMR_GetDefaultConfig(&lptmrConfig);
+    // The default 1 kHz LPO clock can't time sub-millisecond scan steps.
+    lptmrConfig.prescalerClockSource = kLPTMR_PrescalerClock_0;
+    lptmrConfig.bypassPrescaler = false;
+    lptmrConfig.value = kLPTMR_Prescale_Glitch_2;
     LPTMR_Init(KEY_SCANNER_LPTMR_BASEADDR, &lptmrConfig);
 
-    #if KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_MATRIX
-        uint8_t scanCountPerUsec = KEYBOARD_MATRIX_ROWS_NUM;
-    #else
-        uint8_t scanCountPerUsec = 1;
-    #endif
-    LPTMR_SetTimerPeriod(KEY_SCANNER_LPTMR_BASEADDR, USEC_TO_COUNT(1000 / scanCountPerUsec, LPTMR_SOURCE_CLOCK));
+    KeyScanner_SetScanPeriod(MODULE_DEFAULT_SCAN_PERIOD_USEC);
     LPTMR_EnableInterrupts(KEY_SCANNER_LPTMR_BASEADDR, kLPTMR_TimerInterruptEnable);
     EnableIRQ(KEY_SCANNER_LPTMR_IRQ_ID);
-    LPTMR_StartTimer(KEY_SCANNER_LPTMR_BASEADDR);
 }
@@ -7,14 +7,30 @@
 
 // Macros:
 
-    #define LPTMR_SOURCE_CLOCK CLOCK_GetFreq(kCLOCK_LpoClk)
+    #define KEY_SCANNER_LPTMR_CLOCK_HZ 1000000 // The 8 MHz MCGIRCLK divided by 8
 
     #define KEY_SCANNER_LPTMR_BASEADDR LPTMR0
     #define KEY_SCANNER_LPTMR_IRQ_ID   LPTMR0_IRQn
     #define KEY_SCANNER_HANDLER        LPTMR0_IRQHandler
 
+    #if KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_MATRIX
+        #define KEY_SCANNER_SCAN_COUNT_PER_MSEC KEYBOARD_MATRIX_ROWS_NUM
+    #else
+        #define KEY_SCANNER_SCAN_COUNT_PER_MSEC 1
+    #endif
+
+    #define KEY_EVENT_QUEUE_SIZE 8 // Must be a power of two
+
+// Variables:
+
+    extern volatile uint16_t KeyScannerTick;
+    extern volatile uint16_t KeyScannerSampleTick;
+    extern module_key_event_t KeyEvents[KEY_EVENT_QUEUE_SIZE];
+    extern volatile uint8_t KeyEventHead;
+
 // Functions:
 
     void InitKeyScanner(void);
+    void KeyScanner_SetScanPeriod(uint16_t scanPeriodUsec);
 
 #endif
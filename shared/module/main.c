@@ -10,12 +10,14 @@ DEFINE_BOOTLOADER_CONFIG_AREA(I2C_ADDRESS_MODULE_BOOTLOADER)
 int main(void)
 {
     InitClock();
+    InitSlaveProtocolHandler();
     InitPeripherals();
     Module_Init();
     InitKeyScanner();
 
     while (1) {
         Module_Loop();
+        PrestageKeyStatesMessage();
         __WFI();
     }
 }
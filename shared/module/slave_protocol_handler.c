@@ -8,12 +8,46 @@
 #include "bool_array_converter.h"
 #include "bootloader.h"
 #include "module.h"
+#include "module/key_scanner.h"
 #include "versions.h"
 #include <string.h>
+#include <stddef.h>
+
+#define KEY_STATES_MESSAGE_MAX_PAYLOAD_LENGTH ( \
+    BOOL_BYTES_TO_BITS_COUNT(MODULE_KEY_COUNT) + \
+    sizeof(pointer_delta_t) + \
+    sizeof(module_key_events_header_t) + \
+    KEY_EVENT_QUEUE_SIZE * sizeof(module_key_event_t))
+#define NO_KEY_STATES_MESSAGE 0xff
+
+// Same layout as the head of i2c_message_t, just sized for the key states response.
+typedef struct {
+    uint8_t length;
+    uint16_t crc;
+    uint8_t data[KEY_STATES_MESSAGE_MAX_PAYLOAD_LENGTH];
+} ATTR_PACKED key_states_message_t;
+
+// What the master has received once the message gets sent.
+typedef struct {
+    pointer_delta_t pointerTotal;
+    uint8_t keyEventHead;
+} key_states_message_progress_t;
 
 i2c_message_t RxMessage;
 i2c_message_t TxMessage;
 
+// The key states response is built by the main loop into one of these buffers, so that the
+// transmit event usually only has to hand over the ready one. Each staged message is sent at most once.
+static key_states_message_t keyStatesMessages[2];
+static key_states_message_progress_t keyStatesMessageProgresses[2];
+static volatile uint8_t readyKeyStatesMessageIdx = NO_KEY_STATES_MESSAGE;
+static volatile uint8_t sendingKeyStatesMessageIdx = NO_KEY_STATES_MESSAGE;
+
+// PointerDelta and KeyEventHead are only ever advanced by the scanning code. This is how far
+// the master has got of them; only the I2C interrupt writes it.
+static key_states_message_progress_t sentProgress;
+static volatile uint8_t sentSequence;
+
 static version_t moduleProtocolVersion = {
     MODULE_PROTOCOL_MAJOR_VERSION,
     MODULE_PROTOCOL_MINOR_VERSION,
@@ -29,6 +63,28 @@ static version_t firmwareVersion = {
 static const char* gitTag = GIT_TAG;
 static const char* gitRepo = GIT_REPO;
 
+static module_descriptor_t descriptor;
+
+void InitSlaveProtocolHandler(void)
+{
+    descriptor = (module_descriptor_t) {
+        .moduleProtocolVersion = moduleProtocolVersion,
+        .firmwareVersion = firmwareVersion,
+        .moduleId = MODULE_ID,
+        .keyCount = MODULE_KEY_COUNT,
+        .pointerCount = MODULE_POINTER_COUNT,
+    };
+
+    uint16_t hash;
+    crc16_data_t crc16Data;
+    crc16_init(&crc16Data);
+    crc16_update(&crc16Data, (uint8_t*)&descriptor, offsetof(module_descriptor_t, hash));
+    crc16_update(&crc16Data, (const uint8_t*)gitTag, strlen(gitTag));
+    crc16_update(&crc16Data, (const uint8_t*)gitRepo, strlen(gitRepo));
+    crc16_finalize(&crc16Data, &hash);
+    descriptor.hash = hash;
+}
+
 void SlaveRxHandler(void)
 {
     if (!CRC16_IsMessageValid(&RxMessage)) {
@@ -55,10 +111,135 @@ void SlaveRxHandler(void)
            Module_ModuleSpecificCommand(RxMessage.data[1]);
            break;
        }
+        case SlaveCommand_SetScanPeriod: {
+            TxMessage.length = 0;
+            uint16_t scanPeriodUsec = RxMessage.data[1] | RxMessage.data[2] << 8;
+            KeyScanner_SetScanPeriod(scanPeriodUsec);
+            break;
+        }
+    }
+}
+
+static void readPointerTotal(pointer_delta_t *pointerTotal)
+{
+    uint8_t sequence;
+    do {
+        sequence = PointerDeltaSequence;
+        __DMB();
+        pointerTotal->x = PointerDelta.x;
+        pointerTotal->y = PointerDelta.y;
+        __DMB();
+    } while (sequence != PointerDeltaSequence);
+}
+
+static uint8_t addKeyEvents(uint8_t *data, key_states_message_progress_t *progress)
+{
+    module_key_events_header_t *header = (module_key_events_header_t*)data;
+    module_key_event_t *events = (module_key_event_t*)(data + sizeof(module_key_events_header_t));
+
+    uint8_t eventHead = KeyEventHead;
+    uint8_t eventTail = sentProgress.keyEventHead;
+    uint8_t eventCount = eventHead - eventTail;
+    bool isOverflowed = eventCount > KEY_EVENT_QUEUE_SIZE;
+    if (isOverflowed) {
+        eventTail = eventHead - KEY_EVENT_QUEUE_SIZE;
+        eventCount = KEY_EVENT_QUEUE_SIZE;
+    }
+
+    header->sampleTick = KeyScannerSampleTick;
+    header->tick = KeyScannerTick;
+    for (uint8_t i = 0; i < eventCount; i++) {
+        events[i] = KeyEvents[(uint8_t)(eventTail + i) % KEY_EVENT_QUEUE_SIZE];
+    }
+
+    // The oldest copied events may have been overwritten by the scanner meanwhile.
+    if ((uint8_t)(KeyEventHead - eventTail) > KEY_EVENT_QUEUE_SIZE) {
+        isOverflowed = true;
+    }
+    header->eventCount = eventCount | (isOverflowed ? MODULE_KEY_EVENTS_OVERFLOW_MASK : 0);
+    progress->keyEventHead = eventHead;
+
+    return sizeof(module_key_events_header_t) + eventCount * sizeof(module_key_event_t);
+}
+
+static void buildKeyStatesMessage(key_states_message_t *message, key_states_message_progress_t *progress)
+{
+    #if KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_VECTOR
+        BoolBytesToBits(KeyVector.keyStates, message->data, MODULE_KEY_COUNT);
+    #elif KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_MATRIX
+        BoolBytesToBits(KeyMatrix.keyStates, message->data, MODULE_KEY_COUNT);
+    #endif
+    uint8_t messageLength = BOOL_BYTES_TO_BITS_COUNT(MODULE_KEY_COUNT);
+
+    if (MODULE_POINTER_COUNT) {
+        readPointerTotal(&progress->pointerTotal);
+        pointer_delta_t *pointerDelta = (pointer_delta_t*)(message->data + messageLength);
+        pointerDelta->x = progress->pointerTotal.x - sentProgress.pointerTotal.x;
+        pointerDelta->y = progress->pointerTotal.y - sentProgress.pointerTotal.y;
+        messageLength += sizeof(pointer_delta_t);
+    }
+
+    // Taken after the key states, so that the events cover every change in them.
+    messageLength += addKeyEvents(message->data + messageLength, progress);
+    message->length = messageLength;
+
+    // Not CRC16_UpdateMessageChecksum() as its state is shared with the receive handler.
+    uint16_t hash;
+    crc16_data_t crc16Data;
+    crc16_init(&crc16Data);
+    crc16_update(&crc16Data, message->data, message->length);
+    crc16_finalize(&crc16Data, &hash);
+    message->crc = hash;
+}
+
+void PrestageKeyStatesMessage(void)
+{
+    uint8_t messageIdx = readyKeyStatesMessageIdx == 0 ? 1 : 0;
+    if (messageIdx == sendingKeyStatesMessageIdx) {
+        return;
+    }
+
+    key_states_message_progress_t *progress = keyStatesMessageProgresses + messageIdx;
+    uint8_t stagedSequence = sentSequence;
+    __DMB();
+
+    buildKeyStatesMessage(keyStatesMessages + messageIdx, progress);
+
+    // If a message got sent meanwhile, this one is relative to stale progress, so drop it.
+    __disable_irq();
+    if (stagedSequence == sentSequence) {
+        readyKeyStatesMessageIdx = messageIdx;
     }
+    __enable_irq();
 }
 
-void SlaveTxHandler(void)
+void SlaveTransferCompleted(void)
+{
+    sendingKeyStatesMessageIdx = NO_KEY_STATES_MESSAGE;
+}
+
+static i2c_message_t *sendKeyStatesMessage(void)
+{
+    uint8_t messageIdx = readyKeyStatesMessageIdx;
+    readyKeyStatesMessageIdx = NO_KEY_STATES_MESSAGE;
+
+    // The master takes any message with a valid CRC for key states, so if the main loop hasn't
+    // staged one yet, build it here.
+    if (messageIdx == NO_KEY_STATES_MESSAGE) {
+        key_states_message_progress_t progress;
+        buildKeyStatesMessage((key_states_message_t*)&TxMessage, &progress);
+        sentProgress = progress;
+        sentSequence++;
+        return &TxMessage;
+    }
+
+    sendingKeyStatesMessageIdx = messageIdx;
+    sentProgress = keyStatesMessageProgresses[messageIdx];
+    sentSequence++;
+    return (i2c_message_t*)(keyStatesMessages + messageIdx);
+}
+
+i2c_message_t *SlaveTxHandler(void)
 {
     uint8_t commandId = RxMessage.data[0];
     switch (commandId) {
@@ -109,34 +290,18 @@ void SlaveTxHandler(void)
                     TxMessage.length = len;
                     break;
                 }
+                case SlaveProperty_Descriptor: {
+                    memcpy(TxMessage.data, &descriptor, sizeof(module_descriptor_t));
+                    TxMessage.length = sizeof(module_descriptor_t);
+                    break;
+                }
             }
             break;
         }
-        case SlaveCommand_RequestKeyStates: {
-            #if KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_VECTOR
-                BoolBytesToBits(KeyVector.keyStates, TxMessage.data, MODULE_KEY_COUNT);
-            #elif KEY_ARRAY_TYPE == KEY_ARRAY_TYPE_MATRIX
-                BoolBytesToBits(KeyMatrix.keyStates, TxMessage.data, MODULE_KEY_COUNT);
-            #endif
-            uint8_t messageLength = BOOL_BYTES_TO_BITS_COUNT(MODULE_KEY_COUNT);
-            if (MODULE_POINTER_COUNT) {
-                pointer_delta_t *pointerDelta = (pointer_delta_t*)(TxMessage.data + messageLength);
-                __disable_irq();
-                // Gcc compiles those int16_t assignments as sequences of
-                // single-byte instructions, therefore we need to make the
-                // sequence atomic in order to prevent race conditions.
-                // (This handler can be interrupted by sensor interrupts.)
-                pointerDelta->x = PointerDelta.x;
-                pointerDelta->y = PointerDelta.y;
-                PointerDelta.x = 0;
-                PointerDelta.y = 0;
-                __enable_irq();
-                messageLength += sizeof(pointer_delta_t);
-            }
-            TxMessage.length = messageLength;
-            break;
-        }
+        case SlaveCommand_RequestKeyStates:
+            return sendKeyStatesMessage();
     }
 
     CRC16_UpdateMessageChecksum(&TxMessage);
+    return &TxMessage;
 }
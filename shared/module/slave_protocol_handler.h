@@ -14,7 +14,10 @@
 
 // Functions:
 
+    void InitSlaveProtocolHandler(void);
     void SlaveRxHandler(void);
-    void SlaveTxHandler(void);
+    i2c_message_t *SlaveTxHandler(void);
+    void SlaveTransferCompleted(void);
+    void PrestageKeyStatesMessage(void);
 
 #endif
@@ -5,6 +5,7 @@
 
     #include "fsl_common.h"
     #include "attributes.h"
+    #include "versioning.h"
 
 // Macros:
 
@@ -15,6 +16,16 @@
     #define SLAVE_SYNC_STRING "SYNC"
     #define SLAVE_SYNC_STRING_LENGTH (sizeof(SLAVE_SYNC_STRING) - 1)
 
+    #define MODULE_DEFAULT_SCAN_PERIOD_USEC 1000
+    #define MODULE_MIN_SCAN_PERIOD_USEC 250
+    #define MODULE_MAX_SCAN_PERIOD_USEC 10000
+
+    #define MODULE_KEY_EVENT_TICK_USEC 100
+    #define MODULE_KEY_EVENT_PRESSED_MASK 0x80
+    #define MODULE_KEY_EVENT_KEY_ID_MASK 0x7f
+    #define MODULE_KEY_EVENTS_OVERFLOW_MASK 0x80
+    #define MODULE_KEY_EVENTS_COUNT_MASK 0x7f
+
 // Typedefs:
 
     typedef enum {
@@ -24,6 +35,7 @@
         SlaveCommand_SetTestLed,
         SlaveCommand_SetLedPwmBrightness,
         SlaveCommand_ModuleSpecificCommand,
+        SlaveCommand_SetScanPeriod, // Since module protocol 4.4.0
     } slave_command_t;
 
     typedef enum {
@@ -39,6 +51,7 @@
         SlaveProperty_PointerCount,
         SlaveProperty_GitTag,
         SlaveProperty_GitRepo,
+        SlaveProperty_Descriptor, // Since module protocol 4.5.0
     } slave_property_t;
 
     typedef enum {
@@ -68,6 +81,30 @@
         int16_t y;
     } ATTR_PACKED pointer_delta_t;
 
+    // Everything the master needs to know about a module in a single response. The hash
+    // covers all the properties, including the git tag and repo, so the master can skip
+    // fetching those when it has seen the same hash before.
+    typedef struct {
+        version_t moduleProtocolVersion;
+        version_t firmwareVersion;
+        uint8_t moduleId;
+        uint8_t keyCount;
+        uint8_t pointerCount;
+        uint16_t hash;
+    } ATTR_PACKED module_descriptor_t;
+
+    // Follows the pointer delta in the key states response since module protocol 4.3.0.
+    typedef struct {
+        uint16_t tick; // Current module time in MODULE_KEY_EVENT_TICK_USEC units
+        uint8_t eventCount; // MODULE_KEY_EVENTS_OVERFLOW_MASK is set if events got lost before this message
+        uint16_t sampleTick; // Module time of the last completed scan of all keys, since module protocol 4.4.0
+    } ATTR_PACKED module_key_events_header_t;
+
+    typedef struct {
+        uint8_t keyIdAndState;
+        uint16_t tick;
+    } ATTR_PACKED module_key_event_t;
+
 // Variables:
 
     extern char SlaveSyncString[];
@@ -37,6 +37,7 @@
 #define TRACKBALL_SPI_MASTER_SOURCE_CLOCK kCLOCK_BusClk
 
 pointer_delta_t PointerDelta;
+volatile uint8_t PointerDeltaSequence; // Incremented after every update of PointerDelta
 
 key_vector_t KeyVector = {
     .itemNum = KEYBOARD_VECTOR_ITEMS_NUM,
@@ -108,12 +109,14 @@ void trackballUpdate(SPI_Type *base, spi_master_handle_t *masterHandle, status_t
         case ModulePhase_ProcessDeltaY: ;
             int8_t deltaY = (int8_t)rxBuffer[1];
             PointerDelta.x += deltaY; // This is correct given the sensor orientation.
+            PointerDeltaSequence++;
             tx(txBufferGetDeltaX);
             modulePhase = ModulePhase_ProcessDeltaX;
             break;
         case ModulePhase_ProcessDeltaX: ;
             int8_t deltaX = (int8_t)rxBuffer[1];
             PointerDelta.y += deltaX; // This is correct given the sensor orientation.
+            PointerDeltaSequence++;
             tx(txBufferGetMotion);
             modulePhase = ModulePhase_ProcessMotion;
             break;
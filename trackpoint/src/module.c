@@ -2,6 +2,7 @@
 #include "module.h"
 
 pointer_delta_t PointerDelta;
+volatile uint8_t PointerDeltaSequence; // Incremented after every update of PointerDelta
 
 bool shouldReset = false;
 uint8_t resetTimer = 0;
@@ -264,6 +265,7 @@ void PS2_CLOCK_IRQ_HANDLER(void) {
                     PointerDelta.x -= lastX;
                     PointerDelta.y -= lastY;
                 }
+                PointerDeltaSequence++;
                 errno = 0;
                 if (shouldReset) {
                     shouldReset = false;